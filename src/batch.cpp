@@ -0,0 +1,230 @@
+#include<condition_variable>
+#include<cstring>
+#include<memory>
+#include<mutex>
+#include<string_view>
+#include<vector>
+
+#include"batch.hpp"
+#include"board.hpp"
+#include"mappedfile.hpp"
+#include"perft.hpp"
+#include"search.hpp"
+#include"threadpool.hpp"
+#include"tt.hpp"
+
+namespace {
+  /// @brief Lines per chunk for the evaluation, which takes about a microsecond per line
+  constexpr size_t EVAL_CHUNK = 4096;
+
+  /**
+   * @brief Everything a worker reuses from one position to the next, so that analyzing a line allocates nothing
+   */
+  struct Worker {
+    explicit Worker(const Batch::Options& options) noexcept
+      : table(options.mode == Batch::Mode::SEARCH ? options.hash : 1), searcher(this->board, this->table) {
+      this->board.set_network(options.network);
+      this->searcher.set_network(options.network);
+      if(options.mode == Batch::Mode::PERFT && options.hash > 0) this->perft_table = std::make_unique<Perft::Table>(options.hash);
+    }
+
+    Board board;
+    TranspositionTable table;
+    Search::Searcher searcher;
+    std::unique_ptr<Perft::Table> perft_table;
+    std::vector<Movement::move> pv;
+    Batch::Summary summary;
+  };
+
+  /**
+   * @brief A chunk's annotated lines, waiting for the chunks before it to be written
+   */
+  struct Slot {
+    std::string text;
+    bool ready = false;
+  };
+
+  bool is_blank(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\r';
+  }
+
+  /**
+   * @brief Cuts the first lines off a text
+   * @param text The text left, shortened by the lines taken
+   * @param lines The number of lines to take
+   * @return The lines, newlines included
+   */
+  std::string_view take_lines(std::string_view* text, size_t lines) noexcept {
+    const char* const begin = text->data();
+    const char* const end = begin + text->size();
+    const char* cursor = begin;
+    while(lines-- > 0 && cursor < end) {
+      const void* newline = std::memchr(cursor, '\n', static_cast<size_t>(end - cursor));
+      cursor = newline == nullptr ? end : static_cast<const char*>(newline) + 1;
+    }
+    const std::string_view taken(begin, static_cast<size_t>(cursor - begin));
+    text->remove_prefix(taken.size());
+    return taken;
+  }
+
+  bool is_number(std::string_view field) noexcept {
+    if(field.empty()) return false;
+    for(const char c : field) {
+      if(c < '0' || c > '9') return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Finds the position at the start of an EPD or FEN line: its four first fields, and the clocks when the two next fields are numbers
+   */
+  std::string_view position_of(std::string_view line) noexcept {
+    size_t end = 0;
+    size_t field_ends[6] = {};
+    size_t fields = 0;
+    while(fields < 6) {
+      size_t start = end;
+      while(start < line.size() && is_blank(line[start])) start++;
+      if(start == line.size()) break;
+      end = start;
+      while(end < line.size() && !is_blank(line[end])) end++;
+      // The operations after the position are not clocks
+      if(fields >= 4 && !is_number(line.substr(start, end - start))) break;
+      field_ends[fields++] = end;
+    }
+    if(fields == 0) return line.substr(0, 0);
+    return line.substr(0, field_ends[fields == 5 ? 3 : fields - 1]);
+  }
+
+  void append_score(std::string* text, int score) noexcept {
+    if(Search::is_mate(score)) *text += " dm " + std::to_string(Search::mate_in(score)) + ';';
+    else *text += " ce " + std::to_string(score) + ';';
+  }
+
+  /**
+   * @brief Analyzes a single position, appending the results to its line
+   */
+  void analyze(Worker& worker, const Batch::Options& options, std::string* text) noexcept {
+    switch(options.mode) {
+      case Batch::Mode::SEARCH: {
+        // Every position starts from an empty table, so that the results do not depend on which worker got which line
+        worker.table.clear();
+        worker.searcher.set_position(worker.board);
+        Search::Limits limits;
+        limits.depth = options.depth;
+        worker.pv.clear();
+        const Search::Result result = worker.searcher.search(limits, [&worker](const Search::Info& info) { worker.pv = info.pv; });
+        worker.summary.nodes += result.nodes;
+        *text += " acd " + std::to_string(result.depth) + "; acn " + std::to_string(result.nodes) + ';';
+        append_score(text, result.score);
+        if(!worker.pv.empty()) {
+          *text += " pv";
+          for(const Movement::move& mv : worker.pv) *text += ' ' + Movement::from_u16(mv);
+          *text += ';';
+        }
+        break;
+      }
+      case Batch::Mode::PERFT: {
+        const size_t nodes = Perft::run(worker.board, static_cast<size_t>(options.depth), worker.perft_table.get());
+        worker.summary.nodes += nodes;
+        *text += " D" + std::to_string(options.depth) + ' ' + std::to_string(nodes) + ';';
+        break;
+      }
+      case Batch::Mode::EVAL:
+        *text += " ce " + std::to_string(Search::evaluate(worker.board)) + ';';
+        break;
+    }
+  }
+
+  /**
+   * @brief Analyzes every line of a chunk
+   * @param text Cleared, then filled with the annotated lines
+   */
+  void analyze_chunk(Worker& worker, const Batch::Options& options, std::string_view chunk, std::string* text) noexcept {
+    text->clear();
+    State state;
+    while(!chunk.empty()) {
+      std::string_view line = take_lines(&chunk, 1);
+      if(line.back() == '\n') line.remove_suffix(1);
+      while(!line.empty() && is_blank(line.back())) line.remove_suffix(1);
+
+      size_t first = 0;
+      while(first < line.size() && is_blank(line[first])) first++;
+      text->append(line);
+      if(first == line.size() || line[first] == '#') {
+        *text += '\n';
+        continue;
+      }
+
+      const State::FenError error = State::parse_fen(position_of(line), &state);
+      if(error != State::FenError::NONE) {
+        worker.summary.errors++;
+        *text += std::string(" ; error ") + State::describe(error) + '\n';
+        continue;
+      }
+      worker.board.set_state(state);
+      analyze(worker, options, text);
+      worker.summary.positions++;
+      *text += '\n';
+    }
+  }
+}
+
+bool Batch::run(const std::string& path, const Options& options, std::ostream& out, Summary* summary) noexcept {
+  const MappedFile file(path);
+  if(!file.is_open()) return false;
+
+  ThreadPool pool(options.threads);
+  std::vector<std::unique_ptr<Worker>> workers;
+  for(size_t i = 0; i < pool.size(); i++) workers.push_back(std::make_unique<Worker>(options));
+
+  size_t chunk_lines = options.chunk;
+  if(chunk_lines == 0) chunk_lines = options.mode == Mode::EVAL ? EVAL_CHUNK : 1;
+
+  // Chunk `i` goes to slot `i % window`, which is only reused once chunk `i` has been written
+  const size_t window = pool.size() * CHUNKS_PER_WORKER;
+  std::vector<Slot> slots(window);
+  std::mutex mutex;
+  std::condition_variable finished;
+
+  std::string_view rest = file.view();
+  size_t submitted = 0, written = 0;
+  while(true) {
+    if(!rest.empty() && submitted - written < window) {
+      const std::string_view chunk = take_lines(&rest, chunk_lines);
+      Slot* slot = &slots[submitted % window];
+      pool.submit([&, chunk, slot] {
+        analyze_chunk(*workers[pool.current_worker()], options, chunk, &slot->text);
+        {
+          std::lock_guard lock(mutex);
+          slot->ready = true;
+        }
+        finished.notify_one();
+      });
+      submitted++;
+      continue;
+    }
+    if(written == submitted) break;
+
+    Slot& slot = slots[written % window];
+    {
+      std::unique_lock lock(mutex);
+      finished.wait(lock, [&slot] { return slot.ready; });
+      slot.ready = false;
+    }
+    out.write(slot.text.data(), static_cast<std::streamsize>(slot.text.size()));
+    out.flush();
+    written++;
+  }
+  pool.wait();
+
+  if(summary != nullptr) {
+    *summary = Summary();
+    for(const std::unique_ptr<Worker>& worker : workers) {
+      summary->positions += worker->summary.positions;
+      summary->errors += worker->summary.errors;
+      summary->nodes += worker->summary.nodes;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,81 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#pragma once
+#include<cstddef>
+#include<ostream>
+#include<string>
+#include"nnue.hpp"
+
+/**
+ * @brief Namespace holding the offline analysis of whole EPD or FEN files, spread over every core
+ * \code {.cpp}
+ * Batch::Options options;
+ * options.mode = Batch::Mode::SEARCH;
+ * options.depth = 10;
+ * Batch::Summary summary;
+ * std::ofstream out("scored.epd");
+ * Batch::run("positions.epd", options, out, &summary);
+ * \endcode
+ * Every input line gives one output line, in the same order: the line itself followed by the results as EPD operations,
+ * `acd <depth>; acn <nodes>; ce <centipawns>;` (or `dm <moves>;` for a mate) and `pv <moves>;` for a search, `D<depth> <nodes>;` for a perft,
+ * `ce <centipawns>;` for an evaluation. Empty lines and lines starting with `#` are copied as they are, invalid positions get `; error <reason>` appended.
+ */
+namespace Batch {
+  enum class Mode {
+    /// @brief A fixed-depth search
+    SEARCH,
+    /// @brief A count of the positions reachable in a number of plies
+    PERFT,
+    /// @brief The static evaluation, without any search
+    EVAL,
+  };
+
+  /**
+   * @brief What to run on every position, and with how many resources
+   */
+  struct Options {
+    Mode mode = Mode::SEARCH;
+    /// @brief The search or perft depth, in plies
+    int depth = 8;
+    /// @brief The number of worker threads, `0` meaning one per hardware thread
+    size_t threads = 0;
+    /// @brief Size of each worker's transposition table, in megabytes. Perfts only use a table when it is not `0`
+    size_t hash = 16;
+    /// @brief The number of lines handed to a worker at once, `0` picking a size suited to the mode. Cheap modes need large chunks to amortize the hand-over
+    size_t chunk = 0;
+    /// @brief A loaded network shared by every worker, `nullptr` to evaluate with the piece-square tables
+    const NNUE::Network* network = nullptr;
+  };
+
+  /**
+   * @brief Totals over a whole file
+   */
+  struct Summary {
+    /// @brief Positions analyzed, invalid ones excluded
+    size_t positions = 0;
+    /// @brief Lines whose position could not be read
+    size_t errors = 0;
+    /// @brief Nodes searched or counted over every position
+    size_t nodes = 0;
+  };
+
+  /**
+   * @brief Chunks allowed to be in flight per worker. Finished chunks wait for the ones before them to be written, so this bounds the memory held by results
+   */
+  constexpr size_t CHUNKS_PER_WORKER = 4;
+
+  /**
+   * @brief Analyzes every position of a file. \n
+   * The file is mapped rather than read, and cut into chunks of lines handed to a pool of workers, each owning a board and a transposition table.
+   * The results are written as soon as every chunk before them is, so that the output is in input order and can be followed while the run goes on.
+   * @param path An EPD file, or a file of FENs one per line
+   * @param options What to run and how
+   * @param out Where the annotated lines are written
+   * @param summary Filled with the totals, can be `nullptr`
+   * @return `false` if the file could not be read
+   */
+  bool run(const std::string& path, const Options& options, std::ostream& out, Summary* summary) noexcept;
+}
+
+#endif
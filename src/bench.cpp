@@ -0,0 +1,147 @@
+#include<chrono>
+#include<cstdlib>
+#include<iostream>
+#include<memory>
+#include<string>
+
+#include<sys/resource.h>
+
+#include"board.hpp"
+#include"perft.hpp"
+#include"pgn.hpp"
+#include"threadpool.hpp"
+
+/**
+ * @brief A position of the regression suite, with the node count every correct move generator finds at `depth`
+ */
+struct BenchPosition {
+  const char* name;
+  const char* fen;
+  size_t depth;
+  size_t expected;
+};
+
+/// @brief The standard perft positions, followed by edge cases around en passant, castling and promotions
+constexpr BenchPosition SUITE[] = {
+  { "startpos", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 6, 119060324 },
+  { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690 },
+  { "position3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083 },
+  { "position4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292 },
+  { "position5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194 },
+  { "position6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 5, 164075551 },
+  { "illegal_en_passant", "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888 },
+  { "en_passant_gives_check", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467 },
+  { "short_castle_gives_check", "5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072 },
+  { "long_castle_gives_check", "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711 },
+  { "castle_rights", "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206 },
+  { "castling_prevented", "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476 },
+  { "promote_out_of_check", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001 },
+  { "discovered_check", "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658 },
+  { "promote_to_give_check", "4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342 },
+  { "underpromote_to_check", "8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683 },
+  { "self_stalemate", "K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217 },
+  { "stalemate_and_checkmate", "8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584 },
+  { "double_check", "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527 },
+};
+
+/**
+ * @brief A malformed PGN text the reader has to get through, with the totals it must find
+ */
+struct BenchGame {
+  const char* name;
+  const char* text;
+  size_t games;
+  size_t moves;
+  size_t errors;
+};
+
+/// @brief Unbalanced parentheses, which once left the lexer stuck on the same character
+constexpr BenchGame PGN_SUITE[] = {
+  { "unmatched_parenthesis", "1. e4 ) e5 *", 1, 2, 0 },
+  { "parenthesis_after_move", "[Event \"?\"]\n\n1. e4) e5 2. Nf3 (1. d4 e5)) Nc6 *\n", 1, 4, 0 },
+  { "unclosed_variation", "[Event \"?\"]\n\n1. d4 d5 ((2. c4) 2. Nf3 *\n", 1, 2, 0 },
+};
+
+/**
+ * @brief Gets the largest resident set size of the process so far
+ * @return The peak RSS in kilobytes
+ */
+long peak_rss_kb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+/**
+ * @brief Runs the perft and PGN regression suites and prints the results as JSON on the standard output
+ * \code {.sh}
+ * saphirschess_bench [--threads <N>] [--hash <MB>]
+ * \endcode
+ * @return `0` if every node count and PGN total matched, `1` otherwise
+ */
+int main(int argc, char** argv) {
+  size_t threads = 1;
+  size_t hash = 0;
+  for(int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if(arg == "--threads" && i + 1 < argc) threads = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--hash" && i + 1 < argc) hash = std::strtoul(argv[++i], nullptr, 10);
+  }
+
+  std::unique_ptr<ThreadPool> pool;
+  if(threads != 1) pool = std::make_unique<ThreadPool>(threads);
+  std::unique_ptr<Perft::Table> table;
+  if(hash > 0) table = std::make_unique<Perft::Table>(hash);
+
+  bool all_ok = true;
+  size_t total_nodes = 0;
+  double total_seconds = 0;
+
+  std::cout << "{\n  \"threads\": " << (pool ? pool->size() : 1) << ",\n  \"hash_mb\": " << hash << ",\n  \"positions\": [\n";
+
+  constexpr size_t COUNT = sizeof(SUITE) / sizeof(SUITE[0]);
+  for(size_t i = 0; i < COUNT; i++) {
+    const BenchPosition& position = SUITE[i];
+    Board board(position.fen);
+    // Cached counts from the previous position would only be wasted memory traffic
+    if(table) table->clear();
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t nodes;
+    if(pool) nodes = Perft::run_parallel(board, position.depth, table.get(), *pool);
+    else nodes = Perft::run(board, position.depth, table.get());
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const bool ok = nodes == position.expected;
+    all_ok = all_ok && ok;
+    total_nodes += nodes;
+    total_seconds += seconds;
+
+    std::cout << "    { \"name\": \"" << position.name << "\", \"fen\": \"" << position.fen << "\", \"depth\": " << position.depth
+      << ", \"nodes\": " << nodes << ", \"expected\": " << position.expected << ", \"ok\": " << (ok ? "true" : "false")
+      << ", \"time_ms\": " << seconds * 1000 << ", \"nps\": " << static_cast<size_t>(nodes / (seconds > 0 ? seconds : 1e-9))
+      << ", \"peak_rss_kb\": " << peak_rss_kb() << " }" << (i + 1 < COUNT ? "," : "") << '\n';
+  }
+
+  std::cout << "  ],\n  \"pgn\": [\n";
+  constexpr size_t GAMES = sizeof(PGN_SUITE) / sizeof(PGN_SUITE[0]);
+  for(size_t i = 0; i < GAMES; i++) {
+    const BenchGame& game = PGN_SUITE[i];
+    Pgn::Summary summary;
+    Pgn::replay(game.text, [](const Pgn::Position&) {}, &summary);
+    const bool ok = summary.games == game.games && summary.moves == game.moves && summary.errors == game.errors;
+    all_ok = all_ok && ok;
+    std::cout << "    { \"name\": \"" << game.name << "\", \"games\": " << summary.games << ", \"moves\": " << summary.moves
+      << ", \"errors\": " << summary.errors << ", \"ok\": " << (ok ? "true" : "false") << " }" << (i + 1 < GAMES ? "," : "") << '\n';
+  }
+
+  std::cout << "  ],\n  \"total_nodes\": " << total_nodes << ",\n  \"total_time_ms\": " << total_seconds * 1000
+    << ",\n  \"nps\": " << static_cast<size_t>(total_nodes / (total_seconds > 0 ? total_seconds : 1e-9))
+    << ",\n  \"peak_rss_kb\": " << peak_rss_kb() << ",\n  \"ok\": " << (all_ok ? "true" : "false") << "\n}" << std::endl;
+
+  return all_ok ? 0 : 1;
+}
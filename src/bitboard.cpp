@@ -0,0 +1,165 @@
+#include"bitboard.hpp"
+
+using Bitboard::bitboard;
+
+namespace {
+  enum Direction { NORTH, NORTH_EAST, EAST, SOUTH_EAST, SOUTH, SOUTH_WEST, WEST, NORTH_WEST };
+
+  constexpr int row_offsets[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+  constexpr int col_offsets[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+  // RAYS[dir][sq] holds every square reached from `sq` when sliding towards `dir` on an empty board
+  constexpr std::array<std::array<bitboard, 64>, 8> make_rays() noexcept {
+    std::array<std::array<bitboard, 64>, 8> rays{};
+    for(int dir = 0; dir < 8; dir++) {
+      for(int sq = 0; sq < 64; sq++) {
+        int row = sq >> 3;
+        int col = sq & 0b111;
+        while(true) {
+          row += row_offsets[dir];
+          col += col_offsets[dir];
+          if(row < 0 || row > 7 || col < 0 || col > 7) break;
+          rays[dir][sq] |= Bitboard::square((row << 3) | col);
+        }
+      }
+    }
+    return rays;
+  }
+
+  constexpr std::array<std::array<bitboard, 64>, 8> RAYS = make_rays();
+
+  // Rays going towards higher square indexes are cut at their lowest blocker, the others at their highest one
+  template<Direction dir>
+  inline bitboard ray_attacks(int sq, bitboard occupied) noexcept {
+    bitboard attacks = RAYS[dir][sq];
+    const bitboard blockers = attacks & occupied;
+    if(blockers == 0) return attacks;
+
+    constexpr bool positive = dir == NORTH || dir == NORTH_EAST || dir == EAST || dir == NORTH_WEST;
+    const int blocker = positive ? Bitboard::lsb(blockers) : Bitboard::msb(blockers);
+    return attacks ^ RAYS[dir][blocker];
+  }
+
+  // Ray walk used to fill the lookup tables, then never again
+  bitboard slow_bishop_attacks(int sq, bitboard occupied) noexcept {
+    return ray_attacks<NORTH_EAST>(sq, occupied) | ray_attacks<SOUTH_EAST>(sq, occupied) |
+      ray_attacks<SOUTH_WEST>(sq, occupied) | ray_attacks<NORTH_WEST>(sq, occupied);
+  }
+
+  bitboard slow_rook_attacks(int sq, bitboard occupied) noexcept {
+    return ray_attacks<NORTH>(sq, occupied) | ray_attacks<EAST>(sq, occupied) |
+      ray_attacks<SOUTH>(sq, occupied) | ray_attacks<WEST>(sq, occupied);
+  }
+
+  // Total number of blocker subsets over all squares: sum of 2^popcount(mask)
+  bitboard bishop_table[0x1480];
+  bitboard rook_table[0x19000];
+
+  // xorshift64*, seeded with fixed values so that the magics found are the same on every run
+  class Prng {
+    public:
+    explicit Prng(std::uint64_t seed) noexcept : s(seed) {}
+    std::uint64_t next() noexcept {
+      s ^= s >> 12;
+      s ^= s << 25;
+      s ^= s >> 27;
+      return s * 2685821657736338717ULL;
+    }
+    // Magics with few bits set are found much faster
+    std::uint64_t sparse() noexcept { return next() & next() & next(); }
+
+    private:
+    std::uint64_t s;
+  };
+
+  void init_magics(Bitboard::Magic* magics, bitboard* table, bitboard (*slow_attacks)(int, bitboard)) noexcept {
+#ifndef SAPHIRSCHESS_USE_PEXT
+    constexpr std::uint64_t seeds[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+    bitboard occupancies[4096];
+    bitboard references[4096];
+    int epochs[4096] = {};
+    int epoch = 0;
+#endif
+
+    bitboard* attacks = table;
+    for(int sq = 0; sq < 64; sq++) {
+      const bitboard edges = ((Bitboard::RANK_1 | Bitboard::RANK_8) & ~(Bitboard::RANK_1 << (sq & 0b111000))) |
+        ((Bitboard::FILE_A | Bitboard::FILE_H) & ~(Bitboard::FILE_A << (sq & 0b111)));
+
+      Bitboard::Magic& m = magics[sq];
+      m.mask = slow_attacks(sq, 0) & ~edges;
+      m.shift = 64 - Bitboard::count(m.mask);
+      m.attacks = attacks;
+
+      // Carry-Rippler trick to enumerate every subset of the mask
+      int size = 0;
+      bitboard subset = 0;
+      do {
+#ifdef SAPHIRSCHESS_USE_PEXT
+        m.attacks[_pext_u64(subset, m.mask)] = slow_attacks(sq, subset);
+#else
+        occupancies[size] = subset;
+        references[size] = slow_attacks(sq, subset);
+#endif
+        size++;
+        subset = (subset - m.mask) & m.mask;
+      } while(subset);
+      attacks += size;
+
+#ifndef SAPHIRSCHESS_USE_PEXT
+      Prng prng(seeds[sq >> 3]);
+      for(int i = 0; i < size;) {
+        do {
+          m.magic = prng.sparse();
+        } while(Bitboard::count((m.magic * m.mask) >> 56) < 6);
+
+        // A magic is valid when no two subsets with different attacks share an index
+        epoch++;
+        for(i = 0; i < size; i++) {
+          const unsigned int index = m.index(occupancies[i]);
+          if(epochs[index] < epoch) {
+            epochs[index] = epoch;
+            m.attacks[index] = references[i];
+          } else if(m.attacks[index] != references[i]) {
+            break;
+          }
+        }
+      }
+#endif
+    }
+  }
+
+  void init_lines() noexcept {
+    for(int a = 0; a < 64; a++) {
+      for(int b = 0; b < 64; b++) {
+        if(a == b) continue;
+        const bitboard target = Bitboard::square(b);
+
+        if(slow_bishop_attacks(a, 0) & target) {
+          Bitboard::LINE[a][b] = (slow_bishop_attacks(a, 0) & slow_bishop_attacks(b, 0)) | Bitboard::square(a) | target;
+          Bitboard::BETWEEN[a][b] = slow_bishop_attacks(a, target) & slow_bishop_attacks(b, Bitboard::square(a));
+        } else if(slow_rook_attacks(a, 0) & target) {
+          Bitboard::LINE[a][b] = (slow_rook_attacks(a, 0) & slow_rook_attacks(b, 0)) | Bitboard::square(a) | target;
+          Bitboard::BETWEEN[a][b] = slow_rook_attacks(a, target) & slow_rook_attacks(b, Bitboard::square(a));
+        }
+      }
+    }
+  }
+
+  struct MagicInitializer {
+    MagicInitializer() noexcept {
+      init_magics(Bitboard::BISHOP_MAGICS, bishop_table, slow_bishop_attacks);
+      init_magics(Bitboard::ROOK_MAGICS, rook_table, slow_rook_attacks);
+      init_lines();
+    }
+  };
+}
+
+Bitboard::Magic Bitboard::BISHOP_MAGICS[64];
+Bitboard::Magic Bitboard::ROOK_MAGICS[64];
+bitboard Bitboard::BETWEEN[64][64];
+bitboard Bitboard::LINE[64][64];
+
+// Defined after the tables so that it runs once they are zero-initialized
+static const MagicInitializer magic_initializer;
+
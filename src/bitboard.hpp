@@ -0,0 +1,224 @@
+#ifndef BITBOARD_HPP
+#define BITBOARD_HPP
+
+#pragma once
+#include<array>
+#include<bit>
+#include<cstdint>
+#include"piece.hpp"
+
+#if defined(__BMI2__) && !defined(SAPHIRSCHESS_NO_PEXT)
+#include<immintrin.h>
+#define SAPHIRSCHESS_USE_PEXT
+#endif
+
+/**
+ * @brief Namespace used to manipulate sets of squares stored in a single 64-bit integer
+ * Bit `n` of a bitboard is set when the square of index `n` (see \ref Square::from_vec) belongs to the set.
+ * \code {.cpp}
+ * Bitboard::bitboard b = Bitboard::square(0) | Bitboard::square(7); // a1 and h1
+ * int count = Bitboard::count(b); // 2
+ * \endcode
+ */
+namespace Bitboard {
+  using bitboard = std::uint64_t;
+
+  constexpr bitboard EMPTY  = 0ULL;
+  constexpr bitboard FILE_A = 0x0101010101010101ULL;
+  constexpr bitboard FILE_B = FILE_A << 1;
+  constexpr bitboard FILE_G = FILE_A << 6;
+  constexpr bitboard FILE_H = FILE_A << 7;
+  constexpr bitboard RANK_1 = 0xFFULL;
+  constexpr bitboard RANK_2 = RANK_1 << 8;
+  constexpr bitboard RANK_3 = RANK_1 << 16;
+  constexpr bitboard RANK_6 = RANK_1 << 40;
+  constexpr bitboard RANK_7 = RANK_1 << 48;
+  constexpr bitboard RANK_8 = RANK_1 << 56;
+
+  /**
+   * @brief Creates a bitboard containing a single square
+   * @param sq The index of a square (`0`=a1 ... `63`=h8)
+   * @return A bitboard with only bit `sq` set
+   */
+  constexpr bitboard square(int sq) noexcept { return 1ULL << sq; }
+
+  /**
+   * @brief Counts the squares in a set
+   * @param b A bitboard
+   * @return The number of set bits
+   */
+  constexpr int count(bitboard b) noexcept { return std::popcount(b); }
+
+  /**
+   * @brief Gets the lowest square of a non-empty set
+   * @param b A non-empty bitboard
+   * @return The index of the least significant set bit
+   */
+  constexpr int lsb(bitboard b) noexcept { return std::countr_zero(b); }
+
+  /**
+   * @brief Gets the highest square of a non-empty set
+   * @param b A non-empty bitboard
+   * @return The index of the most significant set bit
+   */
+  constexpr int msb(bitboard b) noexcept { return 63 - std::countl_zero(b); }
+
+  /**
+   * @brief Removes the lowest square from a non-empty set and returns it
+   * \code {.cpp}
+   * while(b) {
+   *   int sq = Bitboard::pop_lsb(b);
+   * }
+   * \endcode
+   * @param b A non-empty bitboard, modified in place
+   * @return The index of the square that was removed
+   */
+  constexpr int pop_lsb(bitboard& b) noexcept {
+    const int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+  }
+
+  /**
+   * @brief Shifts every square of a set one row towards the opponent of `color`
+   * @param b A bitboard
+   * @param color The color whose forward direction is used
+   * @return The shifted bitboard (squares leaving the board are dropped)
+   */
+  constexpr bitboard forward(bitboard b, Piece::Color color) noexcept {
+    return color == Piece::Color::WHITE ? b << 8 : b >> 8;
+  }
+
+  /**
+   * @brief Gets every square attacked by a set of pawns of the same color
+   * @param pawns A bitboard of pawns
+   * @param color The color of those pawns
+   * @return The union of their diagonal attacks
+   */
+  constexpr bitboard pawn_attacks(bitboard pawns, Piece::Color color) noexcept {
+    const bitboard west = forward(pawns & ~FILE_A, color) >> 1;
+    const bitboard east = forward(pawns & ~FILE_H, color) << 1;
+    return west | east;
+  }
+
+  namespace detail {
+    constexpr bitboard leaper_attacks(int sq, const int* row_offsets, const int* col_offsets, int len) noexcept {
+      bitboard attacks = EMPTY;
+      const int row = sq >> 3;
+      const int col = sq & 0b111;
+      for(int i = 0; i < len; i++) {
+        const int new_row = row + row_offsets[i];
+        const int new_col = col + col_offsets[i];
+        if(new_row < 0 || new_row > 7 || new_col < 0 || new_col > 7) continue;
+        attacks |= square((new_row << 3) | new_col);
+      }
+      return attacks;
+    }
+
+    constexpr std::array<bitboard, 64> make_knight_table() noexcept {
+      constexpr int row_offsets[8] = { 2, 2, 1, -1, -2, -2, -1, 1 };
+      constexpr int col_offsets[8] = { -1, 1, 2, 2, 1, -1, -2, -2 };
+      std::array<bitboard, 64> table{};
+      for(int sq = 0; sq < 64; sq++) table[sq] = leaper_attacks(sq, row_offsets, col_offsets, 8);
+      return table;
+    }
+
+    constexpr std::array<bitboard, 64> make_king_table() noexcept {
+      constexpr int row_offsets[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+      constexpr int col_offsets[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+      std::array<bitboard, 64> table{};
+      for(int sq = 0; sq < 64; sq++) table[sq] = leaper_attacks(sq, row_offsets, col_offsets, 8);
+      return table;
+    }
+
+    constexpr std::array<std::array<bitboard, 64>, 2> make_pawn_table() noexcept {
+      std::array<std::array<bitboard, 64>, 2> table{};
+      for(int sq = 0; sq < 64; sq++) {
+        table[0][sq] = pawn_attacks(square(sq), Piece::Color::WHITE);
+        table[1][sq] = pawn_attacks(square(sq), Piece::Color::BLACK);
+      }
+      return table;
+    }
+  }
+
+  /// @brief Squares attacked by a knight standing on each square
+  inline constexpr std::array<bitboard, 64> KNIGHT_ATTACKS = detail::make_knight_table();
+  /// @brief Squares attacked by a king standing on each square
+  inline constexpr std::array<bitboard, 64> KING_ATTACKS = detail::make_king_table();
+  /// @brief Squares attacked by a pawn standing on each square, indexed by color (`0`=white, `1`=black) first
+  inline constexpr std::array<std::array<bitboard, 64>, 2> PAWN_ATTACKS = detail::make_pawn_table();
+
+  /**
+   * @brief Lookup data used to find the attacks of a slider on a given square from the board's occupancy
+   * The relevant blockers (`occupied & mask`) are turned into a dense index, either with the BMI2 `PEXT` instruction when the build targets it, or with a magic multiplication otherwise.
+   */
+  struct Magic {
+    /// @brief Squares whose occupancy changes the attacks (board edges excluded)
+    bitboard mask;
+    /// @brief Multiplier mapping every blocker subset of `mask` to a distinct index
+    bitboard magic;
+    /// @brief Start of this square's slice of the attack table
+    bitboard* attacks;
+    /// @brief `64 - popcount(mask)`
+    unsigned int shift;
+
+    /**
+     * @brief Computes the index of the attack set matching `occupied` within \ref Bitboard::Magic::attacks "attacks"
+     * @param occupied Every occupied square of the board
+     * @return An index lower than `2^popcount(mask)`
+     */
+    [[nodiscard]] unsigned int index(bitboard occupied) const noexcept {
+#ifdef SAPHIRSCHESS_USE_PEXT
+      return static_cast<unsigned int>(_pext_u64(occupied, mask));
+#else
+      return static_cast<unsigned int>(((occupied & mask) * magic) >> shift);
+#endif
+    }
+  };
+
+  /// @brief Bishop lookup data for each square, filled during static initialization
+  extern Magic BISHOP_MAGICS[64];
+  /// @brief Rook lookup data for each square, filled during static initialization
+  extern Magic ROOK_MAGICS[64];
+
+  /// @brief `BETWEEN[a][b]` holds the squares strictly between `a` and `b` when they share a row, column or diagonal, nothing otherwise. Filled during static initialization
+  extern bitboard BETWEEN[64][64];
+  /// @brief `LINE[a][b]` holds the whole row, column or diagonal going through both `a` and `b` (edges included), nothing if there is none. Filled during static initialization
+  extern bitboard LINE[64][64];
+
+  /**
+   * @brief Gets the squares attacked by a bishop, stopping each ray at the first occupied square (included)
+   * @param sq The bishop's square
+   * @param occupied Every occupied square of the board
+   * @return The attacked squares
+   */
+  inline bitboard bishop_attacks(int sq, bitboard occupied) noexcept {
+    const Magic& m = BISHOP_MAGICS[sq];
+    return m.attacks[m.index(occupied)];
+  }
+
+  /**
+   * @brief Gets the squares attacked by a rook, stopping each ray at the first occupied square (included)
+   * @param sq The rook's square
+   * @param occupied Every occupied square of the board
+   * @return The attacked squares
+   */
+  inline bitboard rook_attacks(int sq, bitboard occupied) noexcept {
+    const Magic& m = ROOK_MAGICS[sq];
+    return m.attacks[m.index(occupied)];
+  }
+
+  /**
+   * @brief Gets the squares attacked by a queen
+   * @param sq The queen's square
+   * @param occupied Every occupied square of the board
+   * @return The attacked squares
+   * @see Bitboard::bishop_attacks
+   * @see Bitboard::rook_attacks
+   */
+  inline bitboard queen_attacks(int sq, bitboard occupied) noexcept {
+    return bishop_attacks(sq, occupied) | rook_attacks(sq, occupied);
+  }
+}
+
+#endif
@@ -1,25 +1,75 @@
 #include"board.hpp"
+#include"evaluate.hpp"
+#include<array>
 #include<vector>
 #include<algorithm>
 #include<iostream>
 #include<cmath>
-#include<iterator>
-#include <utility>
 
 using std::string;
 using std::vector;
 
-Board::Board(const string& fen_string) noexcept {
-  state = new State(fen_string);
+namespace {
+  // The castling rights left after a move from or to each square: the king's square loses both of its side's rights, a rook's corner its own one
+  constexpr std::array<unsigned char, 64> CASTLING_KEPT = [] {
+    std::array<unsigned char, 64> kept{};
+    kept.fill(0b1111);
+    kept[4] = static_cast<unsigned char>(~(State::CastleRight::WHITE_KINGSIDE | State::CastleRight::WHITE_QUEENSIDE));
+    kept[60] = static_cast<unsigned char>(~(State::CastleRight::BLACK_KINGSIDE | State::CastleRight::BLACK_QUEENSIDE));
+    kept[7] = static_cast<unsigned char>(~State::CastleRight::WHITE_KINGSIDE);
+    kept[0] = static_cast<unsigned char>(~State::CastleRight::WHITE_QUEENSIDE);
+    kept[63] = static_cast<unsigned char>(~State::CastleRight::BLACK_KINGSIDE);
+    kept[56] = static_cast<unsigned char>(~State::CastleRight::BLACK_QUEENSIDE);
+    return kept;
+  }();
+
+  // The move of a list going from and to the same squares as `_m`, with the same promotion
+  Movement::move find_in(const MoveList& moves, const Movement::move& _m) noexcept {
+    for(const Movement::move& mv : moves) {
+      if((mv & 0xFFF) == (_m & 0xFFF) && Movement::promotion_of(mv) == Movement::promotion_of(_m)) return mv;
+    }
+    return 0;
+  }
+}
+
+Board::Board(const string& fen_string) noexcept : state(fen_string) {
+  history.reserve(MAX_PLY);
   generate_legal_moves();
 }
 
-Board::~Board() noexcept {
-  delete state;
+Board::Board(const Board& other) noexcept
+  : state(other.state), legal_moves(other.legal_moves), prefetch_table(other.prefetch_table), network(other.network) {
+  this->history.reserve(MAX_PLY);
+  this->history.assign(other.history.begin(), other.history.end());
+  if(this->network != nullptr) this->accumulators.reserve(MAX_PLY);
+  this->accumulators.assign(other.accumulators.begin(), other.accumulators.end());
+}
+
+Board& Board::operator=(const Board& other) noexcept {
+  if(this == &other) return *this;
+  this->state = other.state;
+  this->legal_moves = other.legal_moves;
+  this->prefetch_table = other.prefetch_table;
+  this->network = other.network;
+
+  this->history.reserve(MAX_PLY);
+  this->history.assign(other.history.begin(), other.history.end());
+  if(this->network != nullptr) this->accumulators.reserve(MAX_PLY);
+  this->accumulators.assign(other.accumulators.begin(), other.accumulators.end());
+  return *this;
+}
+
+Board::~Board() noexcept {}
+
+void Board::set_state(const State& s) noexcept {
+  this->state = s;
+  this->history.clear();
+  generate_legal_moves();
+  this->set_network(this->network);
 }
 
 string Board::get_fen() const noexcept {
-  return this->state->to_fen_string();
+  return this->state.to_fen_string();
 }
 
 string Board::display() const noexcept {
@@ -29,7 +79,7 @@ string Board::display() const noexcept {
   int index = 56;
 
   for(int _ = 0; _ < 64; _++) {
-    char _ucir = Piece::get_uci_representation(this->state->get_board()[index]);
+    char _ucir = Piece::get_uci_representation(this->state.get_board()[index]);
 
     if(_ucir == '-') _ucir = ' ';
     s += "| ";
@@ -48,402 +98,564 @@ string Board::display() const noexcept {
   }
 
   s += "\nFEN: ";
-  s += this->state->to_fen_string();
+  s += this->state.to_fen_string();
 
   return s;
 }
 
-void Board::generate_sliding_moves(
-  const State* s,
-    const int* row_offsets,
-    const int* col_offsets,
-    const int& sq,
-    const Piece::piece& og_piece,
-    const int len,
-    std::vector<Movement::move>* legal_moves) noexcept 
-  {
-
-  const int row = (sq >> 3) & 0b111;
-  const int col = sq & 0b111;
-  const Piece::Color piece_color = Piece::get_color(og_piece);
-
-  for(int dir = 0; dir < len; dir++) {
-    int target = sq;
-    int new_row = row;
-    int new_col = col;
-
-    int depth = 7;
-    if(Piece::get_type(og_piece) == Piece::Type::KING) depth = 1;
-    for(int i = 0; i < depth; i++) {
-      new_row += row_offsets[dir];
-      new_col += col_offsets[dir];
-      if(new_row < 0 || new_row > 7 || new_col < 0 || new_col > 7) break;
-
-      target = (new_row << 3) | new_col; // add offsets to reach the target square
-      Piece::piece _p = s->get_board()[target];
-      if(Piece::get_type(_p) == Piece::Type::NUL) {
-        Movement::move mv = (target << 6) | sq;
-        legal_moves->push_back(mv);
-        continue;
-      }
-
-      // Not an empty space
-      if(Piece::get_color(_p) == piece_color) break;
-      else if(Piece::get_type(_p) == Piece::Type::KING) {
-        Piece::set_flag(_p, Piece::Flag::CHECK, 1);
-        break;
-      } else {
-        Movement::move mv = (target << 6) | sq;
-        legal_moves->push_back(mv);
-        break;
-      }
-    }
+void Board::add_moves(int sq, Bitboard::bitboard targets, Movement::Flag flag, MoveList* legal_moves) noexcept {
+  while(targets) {
+    const int target = Bitboard::pop_lsb(targets);
+    legal_moves->push_back(Movement::make(sq, target, flag));
   }
 }
 
 void Board::generate_legal_moves() noexcept {
-  this->legal_moves = generate_pseudolegal_moves(this->state);
-  remove_pseudolegal_moves();
+  generate_moves<Generation::ALL>(&this->state, &this->legal_moves);
 }
 
-void Board::remove_pseudolegal_moves() noexcept {
-  // Pseudo legal moves include :
-  // - Moving into a check
-  // - Leaving your king checked and not doing anything about it
-  // - Moving out of the way of an attack that threatens your king
-
-  // Getting the king
-  auto* next_state = new State(this->state);
-  Piece::Color cl = *next_state->get_ply_player();
-  int king_square = Square::NULL_SQUARE;
-  for(int i = 0; i < 64; i++) {
-    if(Piece::piece _p = this->state->get_board()[i]; Piece::get_type(_p) == Piece::Type::KING) {
-      king_square = i;
-      break;
-    }
-  }
-
-  auto enemy = static_cast<Piece::Color>(static_cast<char>(cl) ^ 0b1000);
-  *next_state->get_ply_player() = enemy;
-  std::vector<Movement::move> enemy_moves = generate_pseudolegal_moves(next_state);
-  std::vector<unsigned short> attacked_squares = std::vector<unsigned short>();
-
-  for(unsigned short enemy_move : enemy_moves) {
-    int square = (enemy_move >> 6) & 0b111111;
-    attacked_squares.push_back(square);
-  }
+void Board::generate_legal_moves(MoveList* moves) const noexcept {
+  generate_moves<Generation::ALL>(&this->state, moves);
+}
 
-  // Stops king from moving into attacked squares
-  for(int i = 0; i < this->legal_moves.size(); i++) {
-    int origin = this->legal_moves.at(i) & 0b111111;
-    if(origin != king_square) continue;
-
-    int target = (this->legal_moves.at(i) >> 6) & 0b111111;
-    auto index = std::ranges::find(attacked_squares, target);
-    if(index != attacked_squares.end()) {
-      // Convert to const iterator because C++ is a bitch
-      auto const_index = std::as_const(attacked_squares).begin() + std::distance(attacked_squares.begin(), index);
-      // The target square is an attacked square
-      this->legal_moves.erase(const_index);
-    }
+void Board::generate_legal_moves(MoveList* moves, Generation generation) const noexcept {
+  switch(generation) {
+    case Generation::CAPTURES: generate_moves<Generation::CAPTURES>(&this->state, moves); break;
+    case Generation::QUIETS: generate_moves<Generation::QUIETS>(&this->state, moves); break;
+    default: generate_moves<Generation::ALL>(&this->state, moves); break;
   }
-
-
-
 }
 
-std::vector<Movement::move> Board::generate_pseudolegal_moves(State* s) noexcept {
-  std::vector<Movement::move> legal_moves;
-
-  for(int sq = 0; sq < 64; sq++) {
-    int row = (sq >> 3) & 0b111;
-    int col = sq & 0b111;
+bool Board::in_check() const noexcept {
+  const Piece::Color us = this->state.ply_player;
+  const auto them = static_cast<Piece::Color>(us ^ 0b1000);
+  const Bitboard::bitboard king = this->state.get_pieces(Piece::Type::KING, us);
+  if(king == 0) return false;
 
-    Piece::piece current_piece = s->get_board()[sq];
-    Piece::Type piece_type = Piece::get_type(current_piece);
-    if(piece_type == Piece::Type::NUL) continue;
-    Piece::Color piece_color = Piece::get_color(current_piece);
-    if(piece_color != *s->get_ply_player()) continue;
-
-    switch(piece_type) {
+  return (this->state.attackers_to(Bitboard::lsb(king), this->state.get_occupancy()) & this->state.get_occupancy(them)) != 0;
+}
 
-      case Piece::Type::PAWN: {
-        int row_offset = 8;
-        if(piece_color == Piece::Color::BLACK) row_offset *= -1;
-        int col_offset = 1;
+template<Board::Generation G>
+void Board::generate_moves(const State* s, MoveList* legal_moves) noexcept {
+  legal_moves->clear();
+
+  // Resolved at compile time, so that generating everything costs nothing more than before
+  constexpr bool captures = G != Generation::QUIETS;
+  constexpr bool quiets = G != Generation::CAPTURES;
+
+  const Piece::Color us = s->ply_player;
+  const auto them = static_cast<Piece::Color>(us ^ 0b1000);
+  const Bitboard::bitboard own = s->get_occupancy(us);
+  const Bitboard::bitboard enemy = s->get_occupancy(them);
+  const Bitboard::bitboard occupied = own | enemy;
+  const Bitboard::bitboard empty = ~occupied;
+
+  const Bitboard::bitboard king = s->get_pieces(Piece::Type::KING, us);
+  if(king == 0) return;
+  const int king_square = Bitboard::lsb(king);
+
+  const Bitboard::bitboard enemy_rooks = s->get_pieces(Piece::Type::ROOK, them) | s->get_pieces(Piece::Type::QUEEN, them);
+  const Bitboard::bitboard enemy_bishops = s->get_pieces(Piece::Type::BISHOP, them) | s->get_pieces(Piece::Type::QUEEN, them);
+
+  // Pieces giving check, and our pieces standing alone between the king and an enemy slider
+  const Bitboard::bitboard checkers = s->attackers_to(king_square, occupied) & enemy;
+  Bitboard::bitboard pinned = 0;
+  Bitboard::bitboard snipers = (Bitboard::rook_attacks(king_square, 0) & enemy_rooks) | (Bitboard::bishop_attacks(king_square, 0) & enemy_bishops);
+  while(snipers) {
+    const int sniper = Bitboard::pop_lsb(snipers);
+    const Bitboard::bitboard blockers = Bitboard::BETWEEN[king_square][sniper] & occupied;
+    if(Bitboard::count(blockers) == 1) pinned |= blockers & own;
+  }
 
-        // squares to be checked are : the one in front, the one after the one in front, the one to our left & the one to our right
-        int squares_to_check[4] = { sq + row_offset, sq + row_offset * 2, sq + row_offset - col_offset, sq + row_offset + col_offset };
-        int squares_allowed[4] = { true, true, false, false };
+  // Kinds of target squares asked for, promotions and en passant being handled with the pawns
+  const Bitboard::bitboard wanted = (captures ? enemy : 0) | (quiets ? empty : 0);
 
-        if(s->get_board()[squares_to_check[1]] != Piece::Type::NUL) { // no free space 2 steps ahead of us
-          squares_allowed[1] = false;
+  // The king may go anywhere not attacked once it has left its square, so that it cannot hide behind itself from a slider
+  Bitboard::bitboard king_targets = Bitboard::KING_ATTACKS[king_square] & wanted;
+  while(king_targets) {
+    const int target = Bitboard::pop_lsb(king_targets);
+    if(s->attackers_to(target, occupied ^ king) & enemy) continue;
+    legal_moves->push_back(Movement::make(king_square, target, (enemy & Bitboard::square(target)) ? Movement::Flag::CAPTURE : Movement::Flag::QUIET));
+  }
 
-          if(s->get_board()[squares_to_check[0]] != Piece::Type::NUL) squares_allowed[0] = false; // no free space 1 step ahead of us
-        }
+  // Only the king can escape a double check
+  if(Bitboard::count(checkers) > 1) return;
 
-        if(Piece::get_flag(current_piece, Piece::Flag::HAS_MOVED)) { // already moved, can't move 2 spaces ahead
-          squares_allowed[1] = false;
-        }
+  // Squares other pieces must move to: anywhere, or between the king and its only checker (the checker included)
+  Bitboard::bitboard check_mask = ~0ULL;
+  if(checkers) check_mask = Bitboard::BETWEEN[king_square][Bitboard::lsb(checkers)] | checkers;
 
-        Piece::piece left_piece = s->get_board()[squares_to_check[2]];
-        if(Piece::get_color(left_piece) != piece_color && Piece::get_type(left_piece) != Piece::Type::NUL) {
-          squares_allowed[2] = true;
-          if(Piece::get_type(left_piece) == Piece::Type::KING) Piece::set_flag(left_piece, Piece::Flag::CHECK, 1);
-        }
-        if(squares_to_check[2] == *s->get_en_passant()) {
-          if(Piece::get_color(s->get_board()[squares_to_check[2] + row_offset]) != piece_color) squares_allowed[2] = true;
-        }
+  const Bitboard::bitboard targets = wanted & check_mask;
 
-        Piece::piece right_piece = s->get_board()[squares_to_check[3]];
-        if(Piece::get_color(right_piece) != piece_color && Piece::get_type(right_piece) != Piece::Type::NUL) {
-          squares_allowed[3] = true;
-          if(Piece::get_type(right_piece) == Piece::Type::KING) Piece::set_flag(right_piece, Piece::Flag::CHECK, 1);
-        }
-        if(squares_to_check[3] == *s->get_en_passant()) {
-          if(Piece::get_color(s->get_board()[squares_to_check[3] + row_offset]) != piece_color) squares_allowed[3] = true;
+  // Pawns are generated set-wise: every pawn is pushed or captures at once, then the origin square is found back from the target
+  {
+    const Bitboard::bitboard pawns = s->get_pieces(Piece::Type::PAWN, us);
+    const int forward = us == Piece::Color::WHITE ? 8 : -8;
+    const Bitboard::bitboard double_push_rank = us == Piece::Color::WHITE ? Bitboard::RANK_3 : Bitboard::RANK_6;
+    const Bitboard::bitboard promotion_rank = us == Piece::Color::WHITE ? Bitboard::RANK_8 : Bitboard::RANK_1;
+
+    Bitboard::bitboard capturable = enemy;
+    if(s->en_passant != Square::NULL_SQUARE) capturable |= Bitboard::square(s->en_passant);
+
+    // Promotions count as captures, whatever they take, as they change the material as much
+    const Bitboard::bitboard pushes = Bitboard::forward(pawns, us) & empty;
+    const Bitboard::bitboard single_pushes = pushes & ((captures ? promotion_rank : 0) | (quiets ? ~promotion_rank : 0));
+    const Bitboard::bitboard double_pushes = quiets ? Bitboard::forward(pushes & double_push_rank, us) & empty : 0;
+    const Bitboard::bitboard west_captures = captures ? Bitboard::forward(pawns & ~Bitboard::FILE_A, us) >> 1 & capturable : 0;
+    const Bitboard::bitboard east_captures = captures ? Bitboard::forward(pawns & ~Bitboard::FILE_H, us) << 1 & capturable : 0;
+
+    const Bitboard::bitboard sets[4] = { single_pushes, double_pushes, west_captures, east_captures };
+    const int origins[4] = { forward, forward * 2, forward - 1, forward + 1 };
+
+    for(int i = 0; i < 4; i++) {
+      Bitboard::bitboard set = sets[i];
+      while(set) {
+        const int target = Bitboard::pop_lsb(set);
+        const int origin = target - origins[i];
+        const Bitboard::bitboard target_bit = Bitboard::square(target);
+
+        if((pinned & Bitboard::square(origin)) && !(Bitboard::LINE[king_square][origin] & target_bit)) continue;
+
+        const bool en_passant = target == s->en_passant && i >= 2;
+        if(en_passant) {
+          // The captured pawn may be the checker, and removing both pawns from a row may uncover the king
+          const int captured = target - forward;
+          if(!(check_mask & (target_bit | Bitboard::square(captured)))) continue;
+          const Bitboard::bitboard after = (occupied ^ Bitboard::square(origin) ^ Bitboard::square(captured)) | target_bit;
+          if(Bitboard::rook_attacks(king_square, after) & enemy_rooks) continue;
+          if(Bitboard::bishop_attacks(king_square, after) & enemy_bishops) continue;
+        } else if(!(check_mask & target_bit)) {
+          continue;
         }
 
-        // Check if we aren't going outside the board, by checking if all three of those moves are on the same row. If not, one must have somehow wrapped around the board
-        if((squares_to_check[2] & 0b111000) != (squares_to_check[0] & 0b111000)) squares_allowed[2] = false;
-        if((squares_to_check[3] & 0b111000) != (squares_to_check[0] & 0b111000)) squares_allowed[3] = false;
-
-        // Once we finished our checks, add thingies to add to legal moves
-
-        for(int i = 0; i < 4; i++) {
-          if(squares_allowed[i] == false) continue;
-          int target = squares_to_check[i];
-          int origin = sq;
-          Movement::move mv = (target << 6) | origin;
-          legal_moves.push_back(mv);
+        if(target_bit & promotion_rank) {
+          const bool capture = i >= 2;
+          legal_moves->push_back(Movement::make(origin, target, Movement::promotion_flag(Piece::Type::QUEEN, capture)));
+          legal_moves->push_back(Movement::make(origin, target, Movement::promotion_flag(Piece::Type::ROOK, capture)));
+          legal_moves->push_back(Movement::make(origin, target, Movement::promotion_flag(Piece::Type::BISHOP, capture)));
+          legal_moves->push_back(Movement::make(origin, target, Movement::promotion_flag(Piece::Type::KNIGHT, capture)));
+          continue;
         }
-
-        break;
+        // The sets are, in order: single pushes, double pushes, and the captures of either side
+        constexpr Movement::Flag FLAGS[4] = { Movement::Flag::QUIET, Movement::Flag::DOUBLE_PUSH, Movement::Flag::CAPTURE, Movement::Flag::CAPTURE };
+        legal_moves->push_back(Movement::make(origin, target, en_passant ? Movement::Flag::EN_PASSANT : FLAGS[i]));
       }
-      
-      case Piece::Type::KNIGHT: {
-        int row_offsets[8] = { row + 2, row + 2, row + 1, row - 1, row - 2, row - 2, row - 1, row + 1 };
-        int col_offsets[8] = { col - 1, col + 1, col + 2, col + 2, col + 1, col - 1, col - 2, col - 2 };
-
-        // Filter out spaces that go beyond the board's layout
-        for(int i = 0; i < 8; i++) {
-          if(row_offsets[i] > 7 || row_offsets[i] < 0 || col_offsets[i] > 7 || col_offsets[i] < 0) {
-            row_offsets[i] = -1;
-            col_offsets[i] = -1;
-          };
-        }
-
-        // Restrict them into a single array of possibilities
-        int options[8];
-        for(int i = 0; i < 8; i++) {
-          if(row_offsets[i] < 0 || col_offsets[i] < 0) {
-            options[i] = -1;
-            continue;
-          };
-          options[i] = (row_offsets[i] << 3) | col_offsets[i];
-
-          Piece::piece _p = s->get_board()[options[i]];
-          if(Piece::get_color(_p) == piece_color && Piece::get_type(_p) != Piece::Type::NUL) options[i] = -1;
+    }
+  }
 
-          if(Piece::get_type(_p) == Piece::Type::KING && Piece::get_color(_p) != piece_color) Piece::set_flag(_p, Piece::Flag::CHECK, 1);
-        }
+  // A pinned knight can never stay on the pin's line
+  Bitboard::bitboard knights = s->get_pieces(Piece::Type::KNIGHT, us) & ~pinned;
+  while(knights) {
+    const int sq = Bitboard::pop_lsb(knights);
+    const Bitboard::bitboard attacks = Bitboard::KNIGHT_ATTACKS[sq] & targets;
+    add_moves(sq, attacks & enemy, Movement::Flag::CAPTURE, legal_moves);
+    add_moves(sq, attacks & ~enemy, Movement::Flag::QUIET, legal_moves);
+  }
 
-        for(int option : options) {
-          if(option == -1) continue;
-          Movement::move mv = (option << 6) | sq;
-          legal_moves.push_back(mv);
-        }
+  Bitboard::bitboard bishops = s->get_pieces(Piece::Type::BISHOP, us) | s->get_pieces(Piece::Type::QUEEN, us);
+  while(bishops) {
+    const int sq = Bitboard::pop_lsb(bishops);
+    Bitboard::bitboard attacks = Bitboard::bishop_attacks(sq, occupied) & targets;
+    if(pinned & Bitboard::square(sq)) attacks &= Bitboard::LINE[king_square][sq];
+    add_moves(sq, attacks & enemy, Movement::Flag::CAPTURE, legal_moves);
+    add_moves(sq, attacks & ~enemy, Movement::Flag::QUIET, legal_moves);
+  }
 
-        break;
-      }
-      
-      case Piece::Type::BISHOP: {
-        int row_offsets[4] = { 1, -1, -1, 1 };
-        int col_offsets[4] = { 1, 1, -1, -1 };
-        generate_sliding_moves(s, row_offsets, col_offsets, sq, current_piece, 4, &legal_moves);
-        break;
-      }
-      
-      case Piece::Type::ROOK: {
-        int row_offsets[4] = { 1, 0, -1, 0 };
-        int col_offsets[4] = { 0, 1, 0, -1 };
-        generate_sliding_moves(s, row_offsets, col_offsets, sq, current_piece, 4, &legal_moves);
-        break;
-      }
-      
-      case Piece::Type::QUEEN: {
-        int row_offsets[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
-        int col_offsets[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
-        generate_sliding_moves(s, row_offsets, col_offsets, sq, current_piece, 8, &legal_moves);
-        break;
-      }
+  Bitboard::bitboard rooks = s->get_pieces(Piece::Type::ROOK, us) | s->get_pieces(Piece::Type::QUEEN, us);
+  while(rooks) {
+    const int sq = Bitboard::pop_lsb(rooks);
+    Bitboard::bitboard attacks = Bitboard::rook_attacks(sq, occupied) & targets;
+    if(pinned & Bitboard::square(sq)) attacks &= Bitboard::LINE[king_square][sq];
+    add_moves(sq, attacks & enemy, Movement::Flag::CAPTURE, legal_moves);
+    add_moves(sq, attacks & ~enemy, Movement::Flag::QUIET, legal_moves);
+  }
 
-      case Piece::Type::KING: {
-        int row_offsets[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
-        int col_offsets[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
-        generate_sliding_moves(s, row_offsets, col_offsets, sq, current_piece, 8, &legal_moves);
-
-        int queenside = 0b01;
-        int color = static_cast<int>(piece_color) >> 2;
-        
-        int c_square = (row << 3) | 2;
-        int g_square = (row << 3) | 6;
-
-        if(s->get_castle_rights()[color | queenside]) {
-          if(
-            Piece::get_type(s->get_board()[sq - 1]) == Piece::Type::NUL &&
-            Piece::get_type(s->get_board()[sq - 2]) == Piece::Type::NUL &&
-            Piece::get_type(s->get_board()[sq - 3]) == Piece::Type::NUL) {
-              Movement::move mv = (c_square << 6) | sq;
-              legal_moves.push_back(mv);
-            }
+  // Castling: not while in check, the squares in between must be empty and the ones the king crosses unattacked
+  if(quiets && checkers == 0) {
+    int queenside = 0b01;
+    int color = static_cast<int>(us) >> 2;
+    const Bitboard::bitboard own_rooks = s->get_pieces(Piece::Type::ROOK, us);
+
+    if((s->castle_rights & 1 << (color | queenside)) && (own_rooks & Bitboard::square(king_square - 4))) {
+      const Bitboard::bitboard path = Bitboard::square(king_square - 1) | Bitboard::square(king_square - 2) | Bitboard::square(king_square - 3);
+      if((occupied & path) == 0 &&
+        !(s->attackers_to(king_square - 1, occupied) & enemy) &&
+        !(s->attackers_to(king_square - 2, occupied) & enemy)) {
+          legal_moves->push_back(Movement::make(king_square, king_square - 2, Movement::Flag::QUEEN_CASTLE));
         }
-        if(s->get_castle_rights()[color]) {
-          if(
-            Piece::get_type(s->get_board()[sq + 1]) == Piece::Type::NUL &&
-            Piece::get_type(s->get_board()[sq + 2]) == Piece::Type::NUL) {
-              Movement::move mv = (g_square << 6) | sq;
-              legal_moves.push_back(mv);
-            }
+    }
+    if((s->castle_rights & 1 << color) && (own_rooks & Bitboard::square(king_square + 3))) {
+      const Bitboard::bitboard path = Bitboard::square(king_square + 1) | Bitboard::square(king_square + 2);
+      if((occupied & path) == 0 &&
+        !(s->attackers_to(king_square + 1, occupied) & enemy) &&
+        !(s->attackers_to(king_square + 2, occupied) & enemy)) {
+          legal_moves->push_back(Movement::make(king_square, king_square + 2, Movement::Flag::KING_CASTLE));
         }
-        break;
-      }
-      default: break;
     }
   }
 
-  return legal_moves;
+  return;
 }
 
-// ! Oh boy I do sure hope there are *no memory leaks* :D
-
 void Board::make_move(const Movement::move& _m) noexcept {
-  Movement::move root_move = _m & 0b111111111111; // Remove promotion part
-  // Basically means "if not in legal_moves"
-  if(std::ranges::find(this->legal_moves, root_move) == this->legal_moves.end()) return;
-
-  states.push_back(this->state);
-  this->state = new State(this->state);
-
   const unsigned char start = _m & 0b111111;
   const unsigned char target = (_m >> 6) & 0b111111;
-  unsigned char promotion = (_m >> 12) & 0b111;
-
-  const bool reset_halfmove = Piece::get_type(this->state->get_board()[target]) != Piece::Type::NUL ||
-    Piece::get_type(this->state->get_board()[start]) == Piece::Type::PAWN;
-
-  const int row_difference = (target >> 3 & 0b111) - (start >> 3 & 0b111);
-  if(abs(row_difference) == 2 && Piece::get_type(this->state->get_board()[start]) == Piece::Type::PAWN) {
-    const int en_passant_sq = start + (row_difference / 2 * 8); // divide by 2 to get 1 row difference, multiply by 8 to get overall add/sub squares
-    *this->state->get_en_passant() = en_passant_sq;
+  const Movement::Flag flag = Movement::flag_of(_m);
+
+  const Piece::piece moving_piece = this->state.get_board()[start];
+  const Piece::Type moving_type = Piece::get_type(moving_piece);
+
+  Undo undo{};
+  undo.move = _m;
+  undo.en_passant = *this->state.get_en_passant();
+  undo.halfmove = *this->state.get_halfmove_clock();
+  undo.key = this->state.key;
+  undo.pawn_key = this->state.pawn_key;
+  undo.midgame = this->state.midgame;
+  undo.endgame = this->state.endgame;
+  undo.phase = this->state.phase;
+  undo.castle_rights = this->state.castle_rights;
+
+  // The keys are updated by XOR-ing out what leaves the position and XOR-ing in what enters it
+  Zobrist::key key = this->state.key ^ Zobrist::SIDE ^ Zobrist::CASTLING[this->state.get_castle_mask()];
+  Zobrist::key pawn_key = this->state.pawn_key;
+  if(undo.en_passant != Square::NULL_SQUARE) key ^= Zobrist::EN_PASSANT[undo.en_passant & 0b111];
+  // The evaluation sums follow the same pieces as the keys, subtracting what leaves and adding what enters
+  int midgame = this->state.midgame;
+  int endgame = this->state.endgame;
+  int phase = this->state.phase;
+
+  // En passant captures take the pawn right behind the target square
+  const unsigned char captured_square = flag == Movement::Flag::EN_PASSANT ? (start & 0b111000) | (target & 0b111) : target;
+  if(Movement::is_capture(_m)) {
+    undo.captured = this->state.get_board()[captured_square];
+    key ^= Zobrist::PIECES[undo.captured][captured_square];
+    if(Piece::get_type(undo.captured) == Piece::Type::PAWN) pawn_key ^= Zobrist::PIECES[undo.captured][captured_square];
+    midgame -= Evaluation::MIDGAME[undo.captured][captured_square];
+    endgame -= Evaluation::ENDGAME[undo.captured][captured_square];
+    phase -= Evaluation::PHASE[undo.captured];
+    this->state.remove_piece(captured_square);
+  }
+  this->history.push_back(undo);
+
+  // The square skipped by a double push, which is where an en passant capture lands
+  unsigned char en_passant = Square::NULL_SQUARE;
+  unsigned char rook_square = 0, rook_dest_square = 0;
+  switch(flag) {
+    case Movement::Flag::DOUBLE_PUSH:
+      en_passant = static_cast<unsigned char>((start + target) / 2);
+      key ^= Zobrist::EN_PASSANT[en_passant & 0b111];
+      break;
+    case Movement::Flag::KING_CASTLE:
+    case Movement::Flag::QUEEN_CASTLE: {
+      rook_square = static_cast<unsigned char>(flag == Movement::Flag::KING_CASTLE ? target + 1 : target - 2);
+      rook_dest_square = static_cast<unsigned char>(flag == Movement::Flag::KING_CASTLE ? target - 1 : target + 1);
+      const Piece::piece rook = this->state.get_board()[rook_square];
+      key ^= Zobrist::PIECES[rook][rook_square] ^ Zobrist::PIECES[rook][rook_dest_square];
+      midgame += Evaluation::MIDGAME[rook][rook_dest_square] - Evaluation::MIDGAME[rook][rook_square];
+      endgame += Evaluation::ENDGAME[rook][rook_dest_square] - Evaluation::ENDGAME[rook][rook_square];
+      this->state.move_piece(rook_square, rook_dest_square);
+      break;
+    }
+    default:
+      break;
+  }
+  *this->state.get_en_passant() = en_passant;
+
+  // Any move from or to a king or rook starting square loses the matching castling rights
+  this->state.castle_rights &= CASTLING_KEPT[start] & CASTLING_KEPT[target];
+  key ^= Zobrist::CASTLING[this->state.get_castle_mask()];
+
+  key ^= Zobrist::PIECES[moving_piece][start];
+  if(moving_type == Piece::Type::PAWN) pawn_key ^= Zobrist::PIECES[moving_piece][start];
+  midgame -= Evaluation::MIDGAME[moving_piece][start];
+  endgame -= Evaluation::ENDGAME[moving_piece][start];
+  if(Movement::is_promotion(_m)) {
+    Piece::piece promoted = moving_piece;
+    Piece::set_type(promoted, Movement::promotion_of(_m));
+    key ^= Zobrist::PIECES[promoted][target];
+    midgame += Evaluation::MIDGAME[promoted][target];
+    endgame += Evaluation::ENDGAME[promoted][target];
+    phase += Evaluation::PHASE[promoted];
+    this->state.remove_piece(start);
+    this->state.put_piece(target, promoted);
   } else {
-    *this->state->get_en_passant() = Square::NULL_SQUARE;
+    key ^= Zobrist::PIECES[moving_piece][target];
+    if(moving_type == Piece::Type::PAWN) pawn_key ^= Zobrist::PIECES[moving_piece][target];
+    midgame += Evaluation::MIDGAME[moving_piece][target];
+    endgame += Evaluation::ENDGAME[moving_piece][target];
+    this->state.move_piece(start, target);
   }
 
-  int col_difference = (target & 0b111) - (start & 0b111);
-
-  // Castling
-  if(abs(col_difference) == 2 && Piece::get_type(this->state->get_board()[start]) == Piece::Type::KING) {
-    unsigned char target_col = target & 0b111;
-    unsigned char rook_col = 0;
-    unsigned char rook_dest_col = 3;
-    if(target_col == 6) { rook_col = 7; rook_dest_col = 5; }
-
-    unsigned char rook_square = (target & 0b111000) | rook_col;
-    unsigned char rook_dest_square = (target & 0b111000) | rook_dest_col;
-
-    short color = static_cast<short>(Piece::get_color(this->state->get_board()[start])) >> 2;
-
-    this->state->get_castle_rights()[color] = false;
-    this->state->get_castle_rights()[color | 1] = false;
+  // The search probes the new position right after this, the cluster loads while the rest of the move is made
+  if(this->prefetch_table != nullptr) this->prefetch_table->prefetch(key);
+  this->state.key = key;
+  this->state.pawn_key = pawn_key;
+  this->state.midgame = midgame;
+  this->state.endgame = endgame;
+  this->state.phase = phase;
 
-    this->state->get_board()[rook_dest_square] = this->state->get_board()[rook_square];
-    this->state->get_board()[rook_square] = Piece::NIL;
-
-    Piece::set_flag(this->state->get_board()[rook_dest_square], Piece::Flag::HAS_MOVED, 1); 
+  auto pc = static_cast<unsigned char>(*this->state.get_ply_player());
+  pc ^= 0b1000;
+  *this->state.get_ply_player() = static_cast<Piece::Color>(pc);
+
+  if(Movement::is_capture(_m) || moving_type == Piece::Type::PAWN) *this->state.get_halfmove_clock() = 0;
+  else (*this->state.get_halfmove_clock())++;
+
+  if(*this->state.get_ply_player() == Piece::Color::WHITE) (*this->state.get_fullmove_clock())++;
+
+  // The pieces that moved are found again from the move, so that nothing is recorded when no network is set
+  if(this->network != nullptr) {
+    NNUE::Delta delta;
+    delta.remove(moving_piece, start);
+    delta.add(this->state.get_board()[target], target);
+    if(undo.captured != Piece::NIL) delta.remove(undo.captured, captured_square);
+    if(moving_type == Piece::Type::KING) {
+      // A king move changes every feature of its side, the other side only sees the rook when castling
+      delta.refresh[Piece::get_color(moving_piece) >> 3] = true;
+      if(Movement::is_castle(_m)) {
+        delta.remove(this->state.get_board()[rook_dest_square], rook_square);
+        delta.add(this->state.get_board()[rook_dest_square], rook_dest_square);
+      }
+    }
+    this->accumulators.emplace_back();
+    this->network->update(this->accumulators[this->accumulators.size() - 2], &this->accumulators.back(), delta, this->state);
   }
+}
 
-  if(Piece::get_flag(this->state->get_board()[start], Piece::Flag::HAS_MOVED) == 0 &&
-    Piece::get_type(this->state->get_board()[start]) == Piece::Type::ROOK) {
-      const short color = static_cast<short>(Piece::get_color(this->state->get_board()[start])) >> 2;
-      const unsigned char col = start & 0b111;
+void Board::set_network(const NNUE::Network* network) noexcept {
+  this->network = network;
+  this->accumulators.clear();
+  if(network == nullptr) return;
 
-      short queenside = 0;
-      if(col == 0) queenside = 1;
+  this->accumulators.reserve(MAX_PLY);
+  this->accumulators.emplace_back();
+  network->refresh(this->state, Piece::Color::WHITE, &this->accumulators.back());
+  network->refresh(this->state, Piece::Color::BLACK, &this->accumulators.back());
+}
 
-      this->state->get_castle_rights()[color | queenside] = false;
+bool Board::see(const Movement::move& _m, int threshold) const noexcept {
+  using Piece::Type;
+  const State& s = this->state;
+  const int start = _m & 0b111111;
+  const int target = (_m >> 6) & 0b111111;
+  const Type promotion = Movement::promotion_of(_m);
+  const Type moved = Piece::get_type(s.get_board()[start]);
+
+  // Castling never exchanges anything
+  if(Movement::is_castle(_m)) return threshold <= 0;
+
+  Bitboard::bitboard occupied = s.get_occupancy() ^ Bitboard::square(start);
+  Type victim = Piece::get_type(s.get_board()[target]);
+  if(Movement::flag_of(_m) == Movement::Flag::EN_PASSANT) {
+    victim = Type::PAWN;
+    occupied ^= Bitboard::square(target + (s.ply_player == Piece::Color::WHITE ? -8 : 8));
   }
 
-  Piece::set_flag(this->state->get_board()[start], Piece::Flag::HAS_MOVED, 1);
-
-  this->state->get_board()[target] = this->state->get_board()[start];
-  this->state->get_board()[start] = Piece::NIL;
-  auto _p_type = static_cast<Piece::Type>(promotion);
-  if(_p_type != Piece::Type::NUL) Piece::set_type(this->state->get_board()[target], static_cast<Piece::Type>(promotion));
+  // What the move wins if not taken back, then what it loses if taken back for free
+  int swap = SEE_VALUES[victim] - threshold;
+  if(promotion != Type::NUL) swap += SEE_VALUES[promotion] - SEE_VALUES[Type::PAWN];
+  if(swap < 0) return false;
+  swap = SEE_VALUES[promotion != Type::NUL ? promotion : moved] - swap;
+  if(swap <= 0) return true;
+
+  const Bitboard::bitboard bishops = s.get_pieces(Type::BISHOP, Piece::Color::WHITE) | s.get_pieces(Type::BISHOP, Piece::Color::BLACK) |
+    s.get_pieces(Type::QUEEN, Piece::Color::WHITE) | s.get_pieces(Type::QUEEN, Piece::Color::BLACK);
+  const Bitboard::bitboard rooks = s.get_pieces(Type::ROOK, Piece::Color::WHITE) | s.get_pieces(Type::ROOK, Piece::Color::BLACK) |
+    s.get_pieces(Type::QUEEN, Piece::Color::WHITE) | s.get_pieces(Type::QUEEN, Piece::Color::BLACK);
+
+  Bitboard::bitboard attackers = s.attackers_to(target, occupied) & occupied;
+  Piece::Color side = s.ply_player;
+  // Whether the player making the move comes out ahead if the side to capture next stops now
+  bool result = true;
+
+  while(true) {
+    side = static_cast<Piece::Color>(side ^ 0b1000);
+    const Bitboard::bitboard own = attackers & s.get_occupancy(side);
+    if(own == 0) break;
+    result = !result;
+
+    // The least valuable attacker takes, which may uncover a slider behind it on the same line
+    Type type = Type::PAWN;
+    Bitboard::bitboard candidates = 0;
+    for(; type <= Type::KING; type = static_cast<Type>(type + 1)) {
+      candidates = own & s.get_pieces(type, side);
+      if(candidates) break;
+    }
 
-  auto pc = static_cast<unsigned char>(*this->state->get_ply_player());
-  pc ^= 0b1000;
-  *this->state->get_ply_player() = static_cast<Piece::Color>(pc);
+    // Taking with the king is only possible when the other side has nothing left to take back with
+    if(type == Type::KING) return (attackers & ~s.get_occupancy(side)) ? !result : result;
 
-  if(reset_halfmove) *this->state->get_halfmove_clock() = 0;
-  else (*this->state->get_halfmove_clock())++;
+    swap = SEE_VALUES[type] - swap;
+    if(swap < static_cast<int>(result)) break;
 
-  if(*this->state->get_ply_player() == Piece::Color::WHITE) (*this->state->get_fullmove_clock())++;
+    occupied ^= Bitboard::square(Bitboard::lsb(candidates));
+    if(type == Type::PAWN || type == Type::BISHOP || type == Type::QUEEN) attackers |= Bitboard::bishop_attacks(target, occupied) & bishops;
+    if(type == Type::ROOK || type == Type::QUEEN) attackers |= Bitboard::rook_attacks(target, occupied) & rooks;
+    attackers &= occupied;
+  }
 
-  generate_legal_moves();
+  return result;
 }
 
-void Board::unmake_move() noexcept {
-  delete this->state;
-  this->state = states.at(states.size() - 1);
+bool Board::is_draw() const noexcept {
+  const unsigned short halfmove = this->state.halfmove;
+  if(halfmove >= 100) return true;
 
-  states.pop_back();
-  generate_legal_moves();
+  // Only positions with the same player to move and no irreversible move since can repeat
+  const size_t size = this->history.size();
+  const size_t reversible = halfmove < size ? halfmove : size;
+  for(size_t back = 4; back <= reversible; back += 2) {
+    if(this->history[size - back].key == this->state.key) return true;
+  }
+  return false;
 }
 
-Movement::move Movement::from_uci(const string& _ucir) noexcept {
-  char arr[5] = {' ', ' ', ' ', ' ', '-'};
-  vector<char> origin;
-  vector<char> target;
-
-  size_t MAX = _ucir.size();
-  if(MAX > 5) MAX = 5;
-
-  for(size_t i = 0; i < MAX; i++) {
-    arr[i] = _ucir.at(i);
+bool Board::is_legal(const Movement::move& _m) const noexcept {
+  const State& s = this->state;
+  const int start = _m & 0b111111;
+  const int target = (_m >> 6) & 0b111111;
+  const Movement::Flag flag = Movement::flag_of(_m);
+  const Piece::piece moved = s.get_board()[start];
+  if(_m == 0 || moved == Piece::NIL || Piece::get_color(moved) != s.ply_player) return false;
+
+  const Piece::Color us = s.ply_player;
+  const auto them = static_cast<Piece::Color>(us ^ 0b1000);
+  const Bitboard::bitboard enemy = s.get_occupancy(them);
+  const Bitboard::bitboard occupied = s.get_occupancy();
+  const Bitboard::bitboard king = s.get_pieces(Piece::Type::KING, us);
+  const Bitboard::bitboard target_bit = Bitboard::square(target);
+  if(king == 0 || (s.get_occupancy(us) & target_bit)) return false;
+
+  const Piece::Type type = Piece::get_type(moved);
+  if(type != Piece::Type::PAWN && Movement::is_promotion(_m)) return false;
+
+  Bitboard::bitboard captured = enemy & target_bit;
+  // The flag the generator gives the move, which make_move relies on
+  Movement::Flag expected = captured ? Movement::Flag::CAPTURE : Movement::Flag::QUIET;
+  switch(type) {
+    case Piece::Type::PAWN: {
+      const int forward = us == Piece::Color::WHITE ? 8 : -8;
+      const Bitboard::bitboard second_rank = us == Piece::Color::WHITE ? Bitboard::RANK_2 : Bitboard::RANK_7;
+      const bool promotes = (target_bit & (us == Piece::Color::WHITE ? Bitboard::RANK_8 : Bitboard::RANK_1)) != 0;
+      if(promotes != Movement::is_promotion(_m)) return false;
+
+      if(target == start + forward) {
+        if(occupied & target_bit) return false;
+      } else if(target == start + forward * 2) {
+        if(!(Bitboard::square(start) & second_rank) || (occupied & (target_bit | Bitboard::square(start + forward)))) return false;
+        expected = Movement::Flag::DOUBLE_PUSH;
+      } else if(Bitboard::PAWN_ATTACKS[us >> 3][start] & target_bit) {
+        if(target == s.en_passant) {
+          captured = Bitboard::square(target - forward);
+          expected = Movement::Flag::EN_PASSANT;
+        } else if(!captured) {
+          return false;
+        }
+      } else {
+        return false;
+      }
+      if(promotes) expected = Movement::promotion_flag(Movement::promotion_of(_m), captured != 0);
+      break;
+    }
+    case Piece::Type::KNIGHT:
+      if(!(Bitboard::KNIGHT_ATTACKS[start] & target_bit)) return false;
+      break;
+    case Piece::Type::BISHOP:
+      if(!(Bitboard::bishop_attacks(start, occupied) & target_bit)) return false;
+      break;
+    case Piece::Type::ROOK:
+      if(!(Bitboard::rook_attacks(start, occupied) & target_bit)) return false;
+      break;
+    case Piece::Type::QUEEN:
+      if(!((Bitboard::bishop_attacks(start, occupied) | Bitboard::rook_attacks(start, occupied)) & target_bit)) return false;
+      break;
+    case Piece::Type::KING: {
+      // Castling has too many conditions to repeat here, and is rare enough to afford generating the quiet moves
+      if(Movement::is_castle(_m)) {
+        MoveList quiets;
+        generate_moves<Generation::QUIETS>(&s, &quiets);
+        return quiets.contains(_m);
+      }
+      if(flag != expected || !(Bitboard::KING_ATTACKS[start] & target_bit)) return false;
+      return (s.attackers_to(target, occupied ^ king) & enemy & ~captured) == 0;
+    }
+    default:
+      return false;
   }
+  if(flag != expected) return false;
 
-  origin.push_back(arr[0]);
-  origin.push_back(arr[1]);
-  target.push_back(arr[2]);
-  target.push_back(arr[3]);
+  // The king must not be attacked once the move is made, which covers pins, checks and en passant discoveries at once
+  const Bitboard::bitboard after = (occupied ^ Bitboard::square(start) ^ captured) | target_bit;
+  return (s.attackers_to(Bitboard::lsb(king), after) & enemy & ~captured) == 0;
+}
 
-  unsigned short us = 0;
-  us = us | Square::from_vec(origin);
-  us = us | Square::from_vec(target) << 6;
-  us = us | Piece::get_type(Piece::make(arr[4])) << 12;
+Movement::move Board::find_move(const Movement::move& _m) const noexcept {
+  MoveList moves;
+  generate_legal_moves(&moves);
+  return find_in(moves, _m);
+}
 
-  return us;
+bool Board::try_make_move(const Movement::move& _m) noexcept {
+  generate_legal_moves();
+  const Movement::move mv = find_in(this->legal_moves, _m);
+  if(mv == 0) return false;
+
+  make_move(mv);
+  return true;
 }
 
-string Movement::from_u16(const Movement::move& _us) noexcept {
-  string s;
+void Board::unmake_move() noexcept {
+  if(this->history.empty()) return;
 
-  unsigned short origin = _us & 0b111111;
-  unsigned short target = (_us >> 6) & 0b111111;
-  unsigned short promotion = (_us >> 12) & 0b111;
-  Piece::Type promotion_type = Piece::Type::NUL;
-  if(promotion <= 6) promotion_type = static_cast<Piece::Type>(promotion);
+  const Undo undo = this->history.back();
+  this->history.pop_back();
 
-  vector<char> o = Square::from_byte(static_cast<unsigned char>(origin));
-  vector<char> t = Square::from_byte(static_cast<unsigned char>(target));
-  char p = Piece::get_uci_representation(Piece::make(promotion_type, Piece::Color::BLACK));
+  const unsigned char start = undo.move & 0b111111;
+  const unsigned char target = (undo.move >> 6) & 0b111111;
+  const Movement::Flag flag = Movement::flag_of(undo.move);
+
+  auto pc = static_cast<unsigned char>(*this->state.get_ply_player());
+  pc ^= 0b1000;
+  const auto mover = static_cast<Piece::Color>(pc);
+  *this->state.get_ply_player() = mover;
+  if(mover == Piece::Color::BLACK) (*this->state.get_fullmove_clock())--;
+
+  // Put the moving piece back, as a pawn if it was promoted
+  if(Movement::is_promotion(undo.move)) {
+    this->state.remove_piece(target);
+    this->state.put_piece(start, Piece::make(Piece::Type::PAWN, mover));
+  } else {
+    this->state.move_piece(target, start);
+  }
 
-  s += string(o.begin(), o.end());
-  s += string(t.begin(), t.end());
-  if(p != '-') s += p;
+  switch(flag) {
+    case Movement::Flag::KING_CASTLE: this->state.move_piece(target - 1, target + 1); break;
+    case Movement::Flag::QUEEN_CASTLE: this->state.move_piece(target + 1, target - 2); break;
+    case Movement::Flag::EN_PASSANT: this->state.put_piece((start & 0b111000) | (target & 0b111), undo.captured); break;
+    default:
+      if(Movement::is_capture(undo.move)) this->state.put_piece(target, undo.captured);
+      break;
+  }
 
-  return s;
+  *this->state.get_en_passant() = undo.en_passant;
+  *this->state.get_halfmove_clock() = undo.halfmove;
+  this->state.key = undo.key;
+  this->state.pawn_key = undo.pawn_key;
+  this->state.midgame = undo.midgame;
+  this->state.endgame = undo.endgame;
+  this->state.phase = undo.phase;
+  this->state.castle_rights = undo.castle_rights;
+
+  if(this->network != nullptr) {
+    // Moves made before the network was set have no accumulator to go back to
+    if(this->accumulators.size() > 1) {
+      this->accumulators.pop_back();
+    } else {
+      this->network->refresh(this->state, Piece::Color::WHITE, &this->accumulators.back());
+      this->network->refresh(this->state, Piece::Color::BLACK, &this->accumulators.back());
+    }
+  }
 }
 
 size_t Board::perft(size_t depth) noexcept {
@@ -451,9 +663,13 @@ size_t Board::perft(size_t depth) noexcept {
 
   size_t positions = 0;
 
-  size_t SIZE = this->legal_moves.size();
-  for(size_t i = 0; i < SIZE; i++) {
-    make_move(this->legal_moves.at(i));
+  MoveList moves;
+  generate_legal_moves(&moves);
+  // Bulk counting: every legal move leads to exactly one leaf
+  if(depth == 1) return moves.size();
+
+  for(const Movement::move& mv : moves) {
+    make_move(mv);
     positions += perft(depth - 1);
     unmake_move();
   }
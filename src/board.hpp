@@ -3,35 +3,12 @@
 
 #pragma once
 #include<string>
+#include<vector>
+#include"bitboard.hpp"
+#include"movement.hpp"
+#include"nnue.hpp"
 #include"state.hpp"
-
-/**
- * Namespace for use to translate movements into the program's chosen syntax
- */
-namespace Movement {
-  using move = unsigned short;
-  /**
-   * @brief Converts a UCI movement to the program's chosen representation
-   * \code {.cpp}
-   * std::string s = "e2e4"; // move from e2 to e4 square
-   * unsigned short u = Movement::from_uci(s); // returns 0 000 011 100 001 100 (-4e2e)
-   * \endcode
-   * @param _ucir Any UCI movement following the format `crCRp` where `c`=start column ; `r`=start row ; `C`=target column ; `R`=target row ; `p`=promotion (can be omitted)
-   * @return Unsigned short of notation: `xPPPTTTTTTSSSSSS` where `P`=Promotion ; `T`=Target ; `S`=Start
-   */
-  move from_uci(const std::string& _ucir) noexcept;
-
-  /**
-   * @brief Converts this program's chosen movement representation to human-readable UCI notation
-   * \code {.cpp}
-   * unsigned short u = 0b0000011100001100; // see Movement::from_uci(const std::string& _ucir)
-   * std::string s = Movement::from_u16(u);
-   * \endcode
-   * @param _us Unsigned short of notation: `xPPPTTTTTTSSSSSS` where `P`=Promotion ; `T`=Target ; `S`=Start
-   * @return Corresponding UCI movement following the format `crCRp` where `c`=start column ; `r`=start row ; `C`=target column ; `R`=target row ; `p`=promotion (can be omitted)
-   */
-  std::string from_u16(const move& _us) noexcept;
-}
+#include"tt.hpp"
 
 /**
  * Class used to interpret and interact with a chess board
@@ -40,7 +17,25 @@ class Board {
   public:
   explicit Board(const std::string& fen_string) noexcept;
   Board() noexcept : Board(State::STARTING_POSITION_FEN) {};
+  /**
+   * @brief Copies a board, moves made included. \n
+   * A copied vector only gets the capacity it needs, so the copy reserves the history and accumulators again for its moves not to allocate.
+   */
+  Board(const Board& other) noexcept;
+  Board(Board&& other) noexcept = default;
+  Board& operator=(const Board& other) noexcept;
+  Board& operator=(Board&& other) noexcept = default;
   ~Board() noexcept;
+  /**
+   * @brief Replaces the position, forgetting the moves made so far. \n
+   * The memory reserved for the history and accumulators is kept, so that a board reused for many positions allocates nothing.
+   * \code {.cpp}
+   * State state;
+   * if(State::parse_fen(line, &state) == State::FenError::NONE) board.set_state(state);
+   * \endcode
+   * @param s The new position
+   */
+  void set_state(const State& s) noexcept;
   /**
    * @brief Calculates a FEN string from the current state
    * @return a FEN string
@@ -53,21 +48,173 @@ class Board {
   [[nodiscard]] std::string display() const noexcept;
 
   /**
-   * @brief Generates legal moves for this position
+   * @brief Generates legal moves for this position into \ref Board::legal_moves "Board::legal_moves"
    */
   void generate_legal_moves() noexcept;
 
   /**
-   * @brief Makes a move to the board that can be backtracked with \ref Board::unmake_move "Board::unmake_move"
-   * @param _m A movement parsed from UCI into the program's trace (see \ref Movement::from_uci "Movement::from_uci()")
+   * @brief Generates legal moves for this position into a caller-supplied list
+   * \code {.cpp}
+   * MoveList moves;
+   * board.generate_legal_moves(&moves);
+   * \endcode
+   * @param moves A pointer to the list to fill, cleared beforehand
+   * @overload
+   */
+  void generate_legal_moves(MoveList* moves) const noexcept;
+
+  /**
+   * @brief The kinds of moves a generation can be limited to
+   */
+  enum class Generation {
+    /// @brief Every legal move
+    ALL,
+    /// @brief Captures (en passant included) and promotions
+    CAPTURES,
+    /// @brief Every other move, castling included
+    QUIETS
+  };
+
+  /**
+   * @brief Generates only some of the legal moves of this position, so that a search can skip the quiet moves when a capture already refutes it
+   * \code {.cpp}
+   * MoveList captures;
+   * board.generate_legal_moves(&captures, Board::Generation::CAPTURES);
+   * \endcode
+   * @param moves A pointer to the list to fill, cleared beforehand
+   * @param generation The kind of moves to generate, both kinds together giving every legal move
+   * @overload
+   */
+  void generate_legal_moves(MoveList* moves, Generation generation) const noexcept;
+
+  /**
+   * @brief Checks whether a move is legal in the current position, without generating the moves
+   * @param _m Any movement, such as one read from the transposition table or a killer move coming from another position
+   * @return `true` if \ref Board::make_move "Board::make_move" can play it, which requires its flag to be the one the generator would give it
+   */
+  [[nodiscard]] bool is_legal(const Movement::move& _m) const noexcept;
+
+  /**
+   * @brief Getter for the last move made on this board
+   * @return The move, `0` if none was made
+   */
+  [[nodiscard]] Movement::move get_last_move() const noexcept { return this->history.empty() ? 0 : this->history.back().move; }
+
+  /**
+   * @brief Checks whether the player whose turn it is has their king attacked
+   * @return `true` if in check
+   */
+  [[nodiscard]] bool in_check() const noexcept;
+
+  /**
+   * @brief Makes a move to the board that can be backtracked with \ref Board::unmake_move "Board::unmake_move". \n
+   * The position is changed in place and the information needed to undo the move is pushed onto \ref Board::history "Board::history", no memory is allocated.
+   * The move's \ref Movement::Flag "flag" says what kind of move it is, so that castling, en passant and double pushes are not found out from the board.
+   * @param _m A legal movement of the current position, as generated by \ref Board::generate_legal_moves "Board::generate_legal_moves"
+   * @warning The move is not checked for legality, nor its flag, use \ref Board::try_make_move "Board::try_make_move" for moves coming from the outside
    */
   void make_move(const Movement::move& _m) noexcept;
 
+  /**
+   * @brief Makes a move to the board only if it is legal in the current position
+   * \code {.cpp}
+   * board.try_make_move(Movement::from_uci("e2e4"));
+   * \endcode
+   * @param _m A movement parsed from UCI into the program's trace (see \ref Movement::from_uci "Movement::from_uci()"), its flag being ignored apart from the promotion
+   * @return `true` if the move was legal and has been made
+   */
+  bool try_make_move(const Movement::move& _m) noexcept;
+
+  /**
+   * @brief Finds the legal move going from and to the same squares as a move coming from the outside, with the same promotion. \n
+   * Moves read from text only know their squares and promotion, the generated move carries the flag \ref Board::make_move "Board::make_move" needs.
+   * \code {.cpp}
+   * Movement::move mv = board.find_move(Movement::from_uci("e1g1")); // has the KING_CASTLE flag if castling is legal
+   * \endcode
+   * @param _m Any movement, its flag being ignored apart from the promotion
+   * @return The legal move with its flag, `0` if there is none
+   */
+  [[nodiscard]] Movement::move find_move(const Movement::move& _m) const noexcept;
+
   /**
    * @brief Backtracks the last move done on this board
    */
   void unmake_move() noexcept;
 
+  /**
+   * @brief Getter for the current position
+   * \code {.cpp}
+   * Piece::piece _p = board.get_state().get_board()[sq];
+   * \endcode
+   * @return A read-only reference to the current state, changed by \ref Board::make_move "Board::make_move"
+   */
+  [[nodiscard]] const State& get_state() const noexcept { return this->state; }
+
+  /**
+   * @brief Gets the Zobrist key of the current position
+   * @return See \ref State::get_key "State::get_key"
+   */
+  [[nodiscard]] Zobrist::key get_key() const noexcept { return this->state.get_key(); }
+
+  /**
+   * @brief Checks whether a move takes a piece (en passant included)
+   * @param _m A legal movement of the current position
+   * @return `true` if the move is a capture
+   * @see Movement::is_capture
+   */
+  [[nodiscard]] bool is_capture(const Movement::move& _m) const noexcept { return Movement::is_capture(_m); }
+
+  /// @brief Piece values used by \ref Board::see "Board::see", indexed by \ref Piece::Type "Piece::Type"
+  static constexpr int SEE_VALUES[7] = { 0, 100, 320, 330, 500, 900, 0 };
+
+  /**
+   * @brief Static exchange evaluation: plays out the captures on a move's target square, each side always taking back with its least valuable piece and free to stop, without making any move
+   * \code {.cpp}
+   * if(!board.see(mv, 0)) {} // mv loses material
+   * \endcode
+   * Sliders uncovered behind a piece that took part in the exchange join in, pins are ignored.
+   * @param _m A legal movement of the current position
+   * @param threshold The material the exchange must at least win, in the units of \ref Board::SEE_VALUES "Board::SEE_VALUES"
+   * @return `true` if the player making the move wins at least `threshold`
+   */
+  [[nodiscard]] bool see(const Movement::move& _m, int threshold) const noexcept;
+
+  /**
+   * @brief Checks whether the current position is drawn by the 50-move rule or has already occurred since the last capture or pawn move
+   * @return `true` if the position should be scored as a draw
+   */
+  [[nodiscard]] bool is_draw() const noexcept;
+
+  /**
+   * @brief Getter for the number of moves made since this board was created
+   * @return The size of \ref Board::history "Board::history"
+   */
+  [[nodiscard]] size_t get_ply() const noexcept { return this->history.size(); }
+
+  /**
+   * @brief Makes \ref Board::make_move "Board::make_move" prefetch the transposition table entry of every position it reaches, as soon as its key is known
+   * @param table The table to prefetch from, `nullptr` to stop prefetching
+   */
+  void set_prefetch_table(const TranspositionTable* table) noexcept { this->prefetch_table = table; }
+
+  /**
+   * @brief Makes \ref Board::make_move "Board::make_move" keep a network's accumulator up to date, one per ply so that \ref Board::unmake_move "Board::unmake_move" only drops the last one
+   * @param network A loaded network, `nullptr` to stop updating accumulators
+   */
+  void set_network(const NNUE::Network* network) noexcept;
+
+  /**
+   * @brief Getter for the network set with \ref Board::set_network "Board::set_network"
+   * @return The network, `nullptr` if none
+   */
+  [[nodiscard]] const NNUE::Network* get_network() const noexcept { return this->network; }
+
+  /**
+   * @brief Getter for the current position's accumulator
+   * @return The accumulator, only valid while a network is set
+   */
+  [[nodiscard]] const NNUE::Accumulator& get_accumulator() const noexcept { return this->accumulators.back(); }
+
   /**
    * @brief Runs the test suite at a depth of `depth` plies, outputting the number of positions at each ply
    * @param depth The number of plies to look into
@@ -78,35 +225,65 @@ class Board {
   private:
 
   /**
-   * @brief Generates sliding moves in accordance to row_offsets and col_offsets. Moves generated will be outputted into \ref Board::legal_moves "Board::legal_moves"
-   * @param s A pointer to the state to generate the moves from
-   * @param row_offsets Must correspond on a square-basis to col_offsets, used to describe offsets to use as a basis for move generating.
-   * @param col_offsets See row_offsets
+   * @brief Adds one move per square of `targets` starting from `sq`
    * @param sq The original starting square
-   * @param og_piece The original starting piece
-   * @param len Length of the arrays `row_offsets` and `col_offsets`
-   * @param legal_moves A pointer to a vector to store the moves into
+   * @param targets A bitboard of the squares the piece on `sq` can move to
+   * @param flag The kind of every added move, \ref Movement::Flag::CAPTURE "CAPTURE" or \ref Movement::Flag::QUIET "QUIET"
+   * @param legal_moves A pointer to a list to store the moves into
    */
-  static void generate_sliding_moves(const State* s, const int* row_offsets, const int* col_offsets, const int& sq, const Piece::piece& og_piece, int len, std::vector<Movement::move>* legal_moves) noexcept;
+  static void add_moves(int sq, Bitboard::bitboard targets, Movement::Flag flag, MoveList* legal_moves) noexcept;
 
   /**
-   * @brief Removes pseudo legal moves from the available legal moves
+   * @brief Generates the legal moves of a position. \n
+   * Checkers, pinned pieces and the squares that block a check are computed once, so that every generated move is legal without having to be made.
+   * @tparam G The kind of moves to generate
+   * @param s A pointer to a State to analyse
+   * @param legal_moves A pointer to the list to fill, cleared beforehand
    */
-  void remove_pseudolegal_moves() noexcept;
+  template<Generation G>
+  static void generate_moves(const State* s, MoveList* legal_moves) noexcept;
 
   /**
-   * @brief Generates pseudo legal moves of the current position
-   * @param s A pointer to a State to analyse
-   * @return The pseudolegal moves of the position
+   * @brief Everything \ref Board::make_move "Board::make_move" overwrites and cannot deduce back from the move itself
+   */
+  struct Undo {
+    /// @brief The move that was made
+    Movement::move move;
+    /// @brief The piece that was captured, \ref Piece::NIL "Piece::NIL" if none
+    Piece::piece captured;
+    /// @brief The en passant square before the move
+    unsigned char en_passant;
+    /// @brief The castling rights before the move
+    unsigned char castle_rights;
+    /// @brief The halfmove clock before the move
+    unsigned short halfmove;
+    /// @brief The position's key before the move
+    Zobrist::key key;
+    /// @brief The pawns' key before the move
+    Zobrist::key pawn_key;
+    /// @brief The evaluation sums before the move
+    int midgame;
+    int endgame;
+    int phase;
+  };
+
+  /**
+   * @brief The number of plies \ref Board::history "Board::history" holds before it ever needs to grow
    */
-  static std::vector<Movement::move> generate_pseudolegal_moves(State* s) noexcept;
+  static constexpr size_t MAX_PLY = 1024;
 
-  State* state;
-  std::vector<Movement::move> legal_moves = std::vector<Movement::move>();
+  State state;
+  MoveList legal_moves;
   /**
-   * Tracks all the moves done for each ply during this game
+   * Tracks all the moves done for each ply during this game. Reserved upon construction so that making moves never allocates.
    */
-  std::vector<State*> states = std::vector<State*>();
+  std::vector<Undo> history = std::vector<Undo>();
+  /// @brief See \ref Board::set_prefetch_table "Board::set_prefetch_table"
+  const TranspositionTable* prefetch_table = nullptr;
+  /// @brief See \ref Board::set_network "Board::set_network"
+  const NNUE::Network* network = nullptr;
+  /// @brief One accumulator per position since the network was set, the last one being the current position's
+  std::vector<NNUE::Accumulator> accumulators = std::vector<NNUE::Accumulator>();
 };
 
 #endif
\ No newline at end of file
@@ -1,30 +1,234 @@
+#include<chrono>
+#include<cstdlib>
+#include<fstream>
 #include<iostream>
+#include<memory>
 #include<string>
+#include<vector>
 
+#include"batch.hpp"
 #include"board.hpp"
+#include"perft.hpp"
+#include"pgn.hpp"
+#include"search.hpp"
+#include"threadpool.hpp"
+#include"uci.hpp"
 
-int main() {
-  // Board board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
-  Board board;
-
-  std::cout << board.display() << std::endl;
-  // int depth = 3;
-  // std::cout << board.perft(depth) << std::endl;
-  board.make_move(Movement::from_uci("e2e4"));
-  std::cout << board.display() << std::endl;
-  board.make_move(Movement::from_uci("e7e5"));
-  std::cout << board.display() << std::endl;
-  board.make_move(Movement::from_uci("f1d3"));
-  std::cout << board.display() << std::endl;
-  board.make_move(Movement::from_uci("f8d6"));
-  std::cout << board.display() << std::endl;
-  board.make_move(Movement::from_uci("g1f3"));
-  std::cout << board.display() << std::endl;
-  board.make_move(Movement::from_uci("g8f6"));
-  std::cout << board.display() << std::endl;
-  board.make_move(Movement::from_uci("e1g1"));
-  std::cout << board.display() << std::endl;
-  board.make_move(Movement::from_uci("e8g8"));
-  std::cout << board.display() << std::endl;
+/**
+ * @brief Runs `saphirschess perft <depth> [--divide] [--hash <MB>] [--threads <N>] [--stats] [--fen "<fen>"]`
+ * @return The process' exit code
+ */
+int run_perft(int argc, char** argv) {
+  if(argc < 3) {
+    std::cerr << "usage: saphirschess perft <depth> [--divide] [--hash <MB>] [--threads <N>] [--stats] [--fen \"<fen>\"]" << std::endl;
+    return 1;
+  }
+
+  const size_t depth = std::strtoul(argv[2], nullptr, 10);
+  bool divide = false;
+  bool stats = false;
+  size_t hash = 0;
+  size_t threads = 1;
+  std::string fen = State::STARTING_POSITION_FEN;
+
+  for(int i = 3; i < argc; i++) {
+    const std::string arg = argv[i];
+    if(arg == "--divide") divide = true;
+    else if(arg == "--stats") stats = true;
+    else if(arg == "--hash" && i + 1 < argc) hash = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--threads" && i + 1 < argc) threads = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--fen" && i + 1 < argc) fen = argv[++i];
+  }
+
+  Board board(fen);
+
+  if(stats) {
+    std::cout << "depth nodes captures e.p. castles promotions checks" << std::endl;
+    const std::vector<Perft::Statistics> result = Perft::statistics(board, depth);
+    for(size_t i = 0; i < result.size(); i++) {
+      const Perft::Statistics& s = result[i];
+      std::cout << i + 1 << ' ' << s.nodes << ' ' << s.captures << ' ' << s.en_passant << ' ' << s.castles << ' ' << s.promotions << ' ' << s.checks << std::endl;
+    }
+    return 0;
+  }
+  std::unique_ptr<Perft::Table> table;
+  if(hash > 0) table = std::make_unique<Perft::Table>(hash);
+
+  const auto start = std::chrono::steady_clock::now();
+  size_t nodes;
+  if(threads != 1) {
+    ThreadPool pool(threads);
+    if(divide) nodes = Perft::divide_parallel(board, depth, table.get(), pool, std::cout);
+    else nodes = Perft::run_parallel(board, depth, table.get(), pool);
+  } else {
+    if(divide) nodes = Perft::divide(board, depth, table.get(), std::cout);
+    else nodes = Perft::run(board, depth, table.get());
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if(!divide) std::cout << nodes << std::endl;
+  std::cerr << "time: " << elapsed << "s, " << static_cast<size_t>(nodes / (elapsed > 0 ? elapsed : 1e-9)) << " nodes/s" << std::endl;
+  return 0;
+}
+
+/**
+ * @brief Runs `saphirschess search [--depth <N>] [--nodes <N>] [--movetime <ms>] [--hash <MB>] [--threads <N>] [--fen "<fen>"]`, printing every iteration then the best move
+ * @return The process' exit code
+ */
+int run_search(int argc, char** argv) {
+  Search::Limits limits;
+  std::string fen = State::STARTING_POSITION_FEN;
+  size_t hash = 16;
+  size_t threads = 1;
+
+  for(int i = 2; i < argc; i++) {
+    const std::string arg = argv[i];
+    if(arg == "--depth" && i + 1 < argc) limits.depth = std::atoi(argv[++i]);
+    else if(arg == "--nodes" && i + 1 < argc) limits.nodes = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--movetime" && i + 1 < argc) limits.movetime = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--hash" && i + 1 < argc) hash = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--threads" && i + 1 < argc) threads = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--fen" && i + 1 < argc) fen = argv[++i];
+  }
+  if(limits.depth == 0 && limits.nodes == 0 && limits.movetime == 0) limits.depth = 8;
+
+  Board board(fen);
+  TranspositionTable table(hash);
+  Search::Searcher searcher(board, table, threads);
+  const Search::Result result = searcher.search(limits, [](const Search::Info& info) {
+    std::cout << "depth " << info.depth << " seldepth " << info.seldepth << " score " << info.score
+      << " nodes " << info.nodes << " time " << info.time << " pv";
+    for(const Movement::move& mv : info.pv) std::cout << ' ' << Movement::from_u16(mv);
+    std::cout << std::endl;
+  });
+
+  std::cout << "bestmove " << Movement::from_u16(result.best_move) << std::endl;
+  return 0;
+}
+
+/**
+ * @brief Runs `saphirschess batch <file> [--search <depth> | --perft <depth> | --eval] [--threads <N>] [--hash <MB>] [--chunk <lines>] [--output <file>] [--eval-file <network>]`, annotating every position of an EPD or FEN file
+ * @return The process' exit code
+ */
+int run_batch(int argc, char** argv) {
+  if(argc < 3) {
+    std::cerr << "usage: saphirschess batch <file> [--search <depth> | --perft <depth> | --eval] [--threads <N>] [--hash <MB>] [--chunk <lines>] [--output <file>] [--eval-file <network>]" << std::endl;
+    return 1;
+  }
+
+  Batch::Options options;
+  std::string output;
+  std::string eval_file;
+  bool hash_given = false;
+  for(int i = 3; i < argc; i++) {
+    const std::string arg = argv[i];
+    if(arg == "--search" && i + 1 < argc) {
+      options.mode = Batch::Mode::SEARCH;
+      options.depth = std::atoi(argv[++i]);
+    } else if(arg == "--perft" && i + 1 < argc) {
+      options.mode = Batch::Mode::PERFT;
+      options.depth = std::atoi(argv[++i]);
+    } else if(arg == "--eval") {
+      options.mode = Batch::Mode::EVAL;
+    } else if(arg == "--threads" && i + 1 < argc) {
+      options.threads = std::strtoul(argv[++i], nullptr, 10);
+    } else if(arg == "--hash" && i + 1 < argc) {
+      options.hash = std::strtoul(argv[++i], nullptr, 10);
+      hash_given = true;
+    } else if(arg == "--chunk" && i + 1 < argc) {
+      options.chunk = std::strtoul(argv[++i], nullptr, 10);
+    } else if(arg == "--output" && i + 1 < argc) {
+      output = argv[++i];
+    } else if(arg == "--eval-file" && i + 1 < argc) {
+      eval_file = argv[++i];
+    }
+  }
+  // Perfts of positions with few repetitions gain little from a table, they only use one when asked to
+  if(options.mode == Batch::Mode::PERFT && !hash_given) options.hash = 0;
+  if(options.mode == Batch::Mode::SEARCH && options.hash == 0) options.hash = 1;
+
+  NNUE::Network network;
+  if(!eval_file.empty()) {
+    if(!network.load(eval_file)) {
+      std::cerr << "could not load " << eval_file << std::endl;
+      return 1;
+    }
+    options.network = &network;
+  }
+
+  std::ofstream file;
+  if(!output.empty()) {
+    file.open(output, std::ios::binary);
+    if(!file) {
+      std::cerr << "could not write " << output << std::endl;
+      return 1;
+    }
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  Batch::Summary summary;
+  if(!Batch::run(argv[2], options, output.empty() ? std::cout : file, &summary)) {
+    std::cerr << "could not read " << argv[2] << std::endl;
+    return 1;
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cerr << summary.positions << " positions, " << summary.errors << " invalid, " << summary.nodes << " nodes, time: " << elapsed << "s, "
+    << static_cast<size_t>(summary.positions / (elapsed > 0 ? elapsed : 1e-9)) << " positions/s" << std::endl;
+  return summary.errors == 0 ? 0 : 2;
+}
+
+/**
+ * @brief Runs `saphirschess pgn <file> [--threads <N>] [--chunk <bytes>]`, replaying every game of a PGN file and counting the positions reached by result
+ * @return The process' exit code
+ */
+int run_pgn(int argc, char** argv) {
+  if(argc < 3) {
+    std::cerr << "usage: saphirschess pgn <file> [--threads <N>] [--chunk <bytes>]" << std::endl;
+    return 1;
+  }
+
+  Pgn::Options options;
+  for(int i = 3; i < argc; i++) {
+    const std::string arg = argv[i];
+    if(arg == "--threads" && i + 1 < argc) options.threads = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--chunk" && i + 1 < argc) options.chunk = std::strtoul(argv[++i], nullptr, 10);
+  }
+
+  // One tally per worker, padded so that workers do not share cache lines
+  struct alignas(64) Tally {
+    size_t results[4] = {};
+  };
+  std::vector<Tally> tallies(options.threads == 0 ? std::thread::hardware_concurrency() + 1 : options.threads);
+
+  const auto start = std::chrono::steady_clock::now();
+  Pgn::Summary summary;
+  const bool read = Pgn::read(argv[2], options, [&tallies](const Pgn::Position& p) {
+    tallies[p.worker].results[static_cast<size_t>(p.result)]++;
+  }, &summary);
+  if(!read) {
+    std::cerr << "could not read " << argv[2] << std::endl;
+    return 1;
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  size_t results[4] = {};
+  for(const Tally& tally : tallies) {
+    for(size_t i = 0; i < 4; i++) results[i] += tally.results[i];
+  }
+  std::cout << summary.games << " games, " << summary.moves << " moves, " << summary.errors << " stopped by an error" << std::endl;
+  std::cout << "positions by result: " << results[0] << " white wins, " << results[1] << " black wins, " << results[2] << " draws, " << results[3] << " unknown" << std::endl;
+  std::cerr << "time: " << elapsed << "s, " << static_cast<size_t>(summary.moves / (elapsed > 0 ? elapsed : 1e-9)) << " moves/s" << std::endl;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if(argc > 1 && std::string(argv[1]) == "perft") return run_perft(argc, argv);
+  if(argc > 1 && std::string(argv[1]) == "search") return run_search(argc, argv);
+  if(argc > 1 && std::string(argv[1]) == "batch") return run_batch(argc, argv);
+  if(argc > 1 && std::string(argv[1]) == "pgn") return run_pgn(argc, argv);
+
+  UCI::Engine engine(std::cout);
+  engine.loop(std::cin);
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,70 @@
+#include"mappedfile.hpp"
+
+#if __has_include(<sys/mman.h>)
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#define SAPHIRSCHESS_MMAP
+#else
+#include<fstream>
+#include<new>
+#endif
+
+MappedFile::MappedFile(const std::string& path, bool sequential) noexcept {
+#ifdef SAPHIRSCHESS_MMAP
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) return;
+  struct stat info{};
+  if(fstat(fd, &info) != 0) {
+    close(fd);
+    return;
+  }
+  this->size = static_cast<size_t>(info.st_size);
+  // Mapping nothing fails, an empty file is simply an empty view
+  if(this->size == 0) {
+    close(fd);
+    this->open = true;
+    return;
+  }
+  void* mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) {
+    this->size = 0;
+    return;
+  }
+  madvise(mapping, this->size, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+  this->data = static_cast<const char*>(mapping);
+  this->mapped = true;
+#else
+  (void)sequential;
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if(!file) return;
+  this->size = static_cast<size_t>(file.tellg());
+  if(this->size > 0) {
+    auto* buffer = new(std::nothrow) char[this->size];
+    if(buffer == nullptr) {
+      this->size = 0;
+      return;
+    }
+    file.seekg(0);
+    if(!file.read(buffer, static_cast<std::streamsize>(this->size))) {
+      delete[] buffer;
+      this->size = 0;
+      return;
+    }
+    this->data = buffer;
+  }
+#endif
+  this->open = true;
+}
+
+MappedFile::~MappedFile() noexcept {
+  if(this->data == nullptr) return;
+#ifdef SAPHIRSCHESS_MMAP
+  if(this->mapped) munmap(const_cast<char*>(this->data), this->size);
+  else delete[] this->data;
+#else
+  delete[] this->data;
+#endif
+}
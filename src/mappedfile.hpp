@@ -0,0 +1,52 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#pragma once
+#include<cstddef>
+#include<string>
+#include<string_view>
+
+/**
+ * @brief A whole file made readable in memory, mapped where the system allows it and read at once otherwise. \n
+ * Mapping lets the kernel page a large file in as it is read, so that files much larger than the free memory can be scanned.
+ * \code {.cpp}
+ * MappedFile file("positions.epd");
+ * if(file.is_open()) count_lines(file.view());
+ * \endcode
+ */
+class MappedFile {
+  public:
+  /**
+   * @brief Opens a file, read only
+   * @param path The file's path
+   * @param sequential Whether the file is mostly read from start to end, so that the kernel reads ahead
+   */
+  explicit MappedFile(const std::string& path, bool sequential = true) noexcept;
+
+  /**
+   * @brief Unmaps or frees the file's content
+   */
+  ~MappedFile() noexcept;
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * @brief Checks whether the file could be read. An empty file counts as open
+   */
+  [[nodiscard]] bool is_open() const noexcept { return this->open; }
+
+  /**
+   * @brief Getter for the file's content
+   * @return The bytes of the file, valid as long as this object lives
+   */
+  [[nodiscard]] std::string_view view() const noexcept { return std::string_view(this->data, this->size); }
+
+  private:
+  const char* data = nullptr;
+  size_t size = 0;
+  bool open = false;
+  bool mapped = false;
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include"board.hpp"
+#include"movement.hpp"
+
+using std::string;
+using std::string_view;
+
+namespace {
+  /// @brief The letters of each piece type in SAN, pawns having none
+  constexpr char SAN_LETTERS[8] = " PNBRQK";
+  /// @brief The letters of each promotion in UCI
+  constexpr char UCI_LETTERS[8] = "  nbrq ";
+
+  Piece::Type type_of_letter(char c) noexcept {
+    switch(c) {
+      case 'N': case 'n': return Piece::Type::KNIGHT;
+      case 'B': case 'b': return Piece::Type::BISHOP;
+      case 'R': case 'r': return Piece::Type::ROOK;
+      case 'Q': case 'q': return Piece::Type::QUEEN;
+      case 'K': case 'k': return Piece::Type::KING;
+      default: return Piece::Type::NUL;
+    }
+  }
+
+  /**
+   * @brief Reads a square such as `e4`
+   * @return The square's index, `-1` if the two characters are not a square
+   */
+  int read_square(char column, char row) noexcept {
+    if(column < 'a' || column > 'h' || row < '1' || row > '8') return -1;
+    return (row - '1') * 8 + (column - 'a');
+  }
+}
+
+Movement::move Movement::from_uci(string_view _ucir) noexcept {
+  if(_ucir.size() < 4 || _ucir.size() > 5) return 0;
+  const int origin = read_square(_ucir[0], _ucir[1]);
+  const int target = read_square(_ucir[2], _ucir[3]);
+  if(origin < 0 || target < 0) return 0;
+
+  if(_ucir.size() == 4) return make(origin, target);
+  const Piece::Type promotion = type_of_letter(_ucir[4]);
+  if(promotion == Piece::Type::NUL || promotion == Piece::Type::KING) return 0;
+  return make(origin, target, promotion_flag(promotion, false));
+}
+
+size_t Movement::write_uci(const move& _us, char* buffer, size_t size) noexcept {
+  const unsigned short origin = _us & 0b111111;
+  const unsigned short target = (_us >> 6) & 0b111111;
+  const Piece::Type promotion = promotion_of(_us);
+  const bool promotes = promotion != Piece::Type::NUL;
+
+  const size_t length = promotes ? 5 : 4;
+  if(size <= length) return 0;
+  buffer[0] = static_cast<char>('a' + origin % 8);
+  buffer[1] = static_cast<char>('1' + origin / 8);
+  buffer[2] = static_cast<char>('a' + target % 8);
+  buffer[3] = static_cast<char>('1' + target / 8);
+  if(promotes) buffer[4] = UCI_LETTERS[promotion];
+  buffer[length] = '\0';
+  return length;
+}
+
+string Movement::from_u16(const move& _us) noexcept {
+  char buffer[MAX_UCI_LENGTH];
+  return string(buffer, write_uci(_us, buffer, sizeof(buffer)));
+}
+
+Movement::move Movement::from_san(const Board& board, string_view _san) noexcept {
+  MoveList legal;
+  board.generate_legal_moves(&legal);
+  return from_san(board, _san, legal);
+}
+
+Movement::move Movement::from_san(const Board& board, string_view _san, const MoveList& legal) noexcept {
+  while(!_san.empty() && (_san.back() == '+' || _san.back() == '#' || _san.back() == '!' || _san.back() == '?')) _san.remove_suffix(1);
+  const Piece::piece* squares = board.get_state().get_board();
+
+  if(_san == "O-O" || _san == "0-0" || _san == "O-O-O" || _san == "0-0-0") {
+    const Flag side = _san.size() == 3 ? Flag::KING_CASTLE : Flag::QUEEN_CASTLE;
+    for(const move& mv : legal) {
+      if(flag_of(mv) == side) return mv;
+    }
+    return 0;
+  }
+
+  // A promotion's letter follows its row, `=` being sometimes left out
+  Piece::Type promotion = Piece::Type::NUL;
+  if(_san.size() >= 3) {
+    const Piece::Type letter = type_of_letter(_san.back());
+    const char before = _san[_san.size() - 2];
+    if(letter != Piece::Type::NUL && letter != Piece::Type::KING && (before == '=' || before == '1' || before == '8')) {
+      promotion = letter;
+      _san.remove_suffix(before == '=' ? 2 : 1);
+    }
+  }
+
+  if(_san.size() < 2) return 0;
+  const int target = read_square(_san[_san.size() - 2], _san[_san.size() - 1]);
+  if(target < 0) return 0;
+  _san.remove_suffix(2);
+
+  Piece::Type type = Piece::Type::PAWN;
+  if(!_san.empty() && _san.front() >= 'A' && _san.front() <= 'Z') {
+    type = type_of_letter(_san.front());
+    if(type == Piece::Type::NUL) return 0;
+    _san.remove_prefix(1);
+  }
+
+  int from_column = -1, from_row = -1;
+  for(const char c : _san) {
+    if(c >= 'a' && c <= 'h') from_column = c - 'a';
+    else if(c >= '1' && c <= '8') from_row = c - '1';
+    else if(c != 'x' && c != ':' && c != '-') return 0;
+  }
+
+  move found = 0;
+  for(const move& mv : legal) {
+    const int start = mv & 0b111111;
+    if(((mv >> 6) & 0b111111) != target || Piece::get_type(squares[start]) != type) continue;
+    if(promotion_of(mv) != promotion) continue;
+    if((from_column >= 0 && start % 8 != from_column) || (from_row >= 0 && start / 8 != from_row)) continue;
+    // Ambiguous
+    if(found != 0) return 0;
+    found = mv;
+  }
+  return found;
+}
+
+size_t Movement::write_san(Board& board, const move& _m, char* buffer, size_t size) noexcept {
+  char san[MAX_SAN_LENGTH];
+  size_t length = 0;
+
+  const int start = _m & 0b111111;
+  const int target = (_m >> 6) & 0b111111;
+  const Piece::Type promotion = promotion_of(_m);
+  const Piece::piece* squares = board.get_state().get_board();
+  const Piece::Type type = Piece::get_type(squares[start]);
+
+  if(is_castle(_m)) {
+    for(const char c : string_view(flag_of(_m) == Flag::KING_CASTLE ? "O-O" : "O-O-O")) san[length++] = c;
+  } else {
+    const bool capture = is_capture(_m);
+    if(type == Piece::Type::PAWN) {
+      if(capture) san[length++] = static_cast<char>('a' + start % 8);
+    } else {
+      san[length++] = SAN_LETTERS[type];
+      // Name the start column when it tells the pieces apart, else the start row, else both
+      MoveList legal;
+      board.generate_legal_moves(&legal);
+      bool ambiguous = false, same_column = false, same_row = false;
+      for(const move& mv : legal) {
+        const int other = mv & 0b111111;
+        if(other == start || ((mv >> 6) & 0b111111) != target || Piece::get_type(squares[other]) != type) continue;
+        ambiguous = true;
+        same_column |= other % 8 == start % 8;
+        same_row |= other / 8 == start / 8;
+      }
+      if(ambiguous && (!same_column || same_row)) san[length++] = static_cast<char>('a' + start % 8);
+      if(ambiguous && same_column) san[length++] = static_cast<char>('1' + start / 8);
+    }
+    if(capture) san[length++] = 'x';
+    san[length++] = static_cast<char>('a' + target % 8);
+    san[length++] = static_cast<char>('1' + target / 8);
+    if(promotion != Piece::Type::NUL) {
+      san[length++] = '=';
+      san[length++] = SAN_LETTERS[promotion];
+    }
+  }
+
+  board.make_move(_m);
+  if(board.in_check()) {
+    MoveList replies;
+    board.generate_legal_moves(&replies);
+    san[length++] = replies.empty() ? '#' : '+';
+  }
+  board.unmake_move();
+
+  if(size <= length) return 0;
+  for(size_t i = 0; i < length; i++) buffer[i] = san[i];
+  buffer[length] = '\0';
+  return length;
+}
+
+string Movement::to_san(Board& board, const move& _m) noexcept {
+  char buffer[MAX_SAN_LENGTH];
+  return string(buffer, write_san(board, _m, buffer, sizeof(buffer)));
+}
@@ -0,0 +1,231 @@
+#ifndef MOVEMENT_HPP
+#define MOVEMENT_HPP
+
+#pragma once
+#include<cstddef>
+#include<string>
+#include<string_view>
+#include"piece.hpp"
+
+class Board;
+class MoveList;
+
+/**
+ * Namespace for use to translate movements into the program's chosen syntax
+ */
+namespace Movement {
+  /// @brief Unsigned short of notation: `FFFFTTTTTTSSSSSS` where `F`=\ref Movement::Flag "Flag" ; `T`=Target ; `S`=Start
+  using move = unsigned short;
+
+  /**
+   * @brief The kind of a movement, stored in its 4 highest bits so that making it needs no look at the board. \n
+   * Bit 3 is set for promotions, whose 2 lowest bits give the piece from knight to queen, and bit 2 for captures, en passant included.
+   */
+  enum Flag : unsigned char {
+    QUIET                    = 0b0000,
+    /// @brief A pawn moving two squares forward, which gives an en passant square
+    DOUBLE_PUSH              = 0b0001,
+    /// @brief Castling with the rook of the `h` column, given as the king moving two squares
+    KING_CASTLE              = 0b0010,
+    /// @brief Castling with the rook of the `a` column, given as the king moving two squares
+    QUEEN_CASTLE             = 0b0011,
+    CAPTURE                  = 0b0100,
+    /// @brief A pawn taking the pawn that just moved two squares, landing behind it
+    EN_PASSANT               = 0b0101,
+    KNIGHT_PROMOTION         = 0b1000,
+    BISHOP_PROMOTION         = 0b1001,
+    ROOK_PROMOTION           = 0b1010,
+    QUEEN_PROMOTION          = 0b1011,
+    KNIGHT_PROMOTION_CAPTURE = 0b1100,
+    BISHOP_PROMOTION_CAPTURE = 0b1101,
+    ROOK_PROMOTION_CAPTURE   = 0b1110,
+    QUEEN_PROMOTION_CAPTURE  = 0b1111,
+  };
+
+  /**
+   * @brief Builds a movement
+   * \code {.cpp}
+   * Movement::move mv = Movement::make(12, 28, Movement::Flag::DOUBLE_PUSH); // e2e4
+   * \endcode
+   * @param start The index of the start square
+   * @param target The index of the target square
+   * @param flag The kind of movement
+   */
+  constexpr move make(int start, int target, Flag flag = Flag::QUIET) noexcept {
+    return static_cast<move>(start | target << 6 | flag << 12);
+  }
+
+  /// @brief Getter for the kind of a movement
+  constexpr Flag flag_of(const move& _m) noexcept { return static_cast<Flag>(_m >> 12); }
+
+  /// @brief Checks whether a movement takes a piece, en passant included
+  constexpr bool is_capture(const move& _m) noexcept { return (_m >> 12) & 0b0100; }
+
+  /// @brief Checks whether a movement promotes a pawn
+  constexpr bool is_promotion(const move& _m) noexcept { return (_m >> 12) & 0b1000; }
+
+  /// @brief Checks whether a movement is castling, on either side
+  constexpr bool is_castle(const move& _m) noexcept { return (_m >> 13) == 0b001; }
+
+  /**
+   * @brief Getter for the piece a movement promotes to
+   * @return \ref Piece::Type::NUL "Type::NUL" if the movement is not a promotion
+   */
+  constexpr Piece::Type promotion_of(const move& _m) noexcept {
+    return is_promotion(_m) ? static_cast<Piece::Type>(Piece::Type::KNIGHT + ((_m >> 12) & 0b11)) : Piece::Type::NUL;
+  }
+
+  /**
+   * @brief Builds the flag of a promotion
+   * @param promotion A piece type from \ref Piece::Type::KNIGHT "KNIGHT" to \ref Piece::Type::QUEEN "QUEEN"
+   * @param capture Whether the promoting pawn takes a piece
+   */
+  constexpr Flag promotion_flag(Piece::Type promotion, bool capture) noexcept {
+    return static_cast<Flag>(Flag::KNIGHT_PROMOTION | (capture ? Flag::CAPTURE : 0) | (promotion - Piece::Type::KNIGHT));
+  }
+
+  /// @brief The longest UCI movement \ref Movement::write_uci "Movement::write_uci" can produce, terminating null character included
+  constexpr size_t MAX_UCI_LENGTH = 6;
+  /// @brief The longest SAN movement \ref Movement::write_san "Movement::write_san" can produce, terminating null character included, such as `Qa1xb2+`
+  constexpr size_t MAX_SAN_LENGTH = 8;
+
+  /**
+   * @brief Converts a UCI movement to the program's chosen representation
+   * \code {.cpp}
+   * std::string s = "e2e4"; // move from e2 to e4 square
+   * unsigned short u = Movement::from_uci(s); // returns 0000 011100 001100 (e4e2, without its DOUBLE_PUSH flag)
+   * \endcode
+   * @param _ucir Any UCI movement following the format `crCRp` where `c`=start column ; `r`=start row ; `C`=target column ; `R`=target row ; `p`=promotion (can be omitted)
+   * @return Unsigned short of notation: `FFFFTTTTTTSSSSSS` where `F`=Flag ; `T`=Target ; `S`=Start, `0` if `_ucir` is not a movement. \n
+   * Only the promotion can be told from the text, the other flags are left unset: use \ref Board::try_make_move "Board::try_make_move" or \ref Board::find_move "Board::find_move" to get the full movement
+   */
+  move from_uci(std::string_view _ucir) noexcept;
+
+  /**
+   * @brief Writes a movement in UCI notation to a caller-supplied buffer, without allocating
+   * \code {.cpp}
+   * char uci[Movement::MAX_UCI_LENGTH];
+   * size_t length = Movement::write_uci(mv, uci, sizeof(uci));
+   * \endcode
+   * @param _us Unsigned short of notation: `FFFFTTTTTTSSSSSS` where `F`=Flag ; `T`=Target ; `S`=Start
+   * @param buffer Where the movement is written, followed by a null character
+   * @param size The size of the buffer, \ref Movement::MAX_UCI_LENGTH "MAX_UCI_LENGTH" always being enough
+   * @return The length of the movement, null character excluded, or `0` if the buffer is too small
+   */
+  size_t write_uci(const move& _us, char* buffer, size_t size) noexcept;
+
+  /**
+   * @brief Converts this program's chosen movement representation to human-readable UCI notation
+   * \code {.cpp}
+   * unsigned short u = 0b0000011100001100; // see Movement::from_uci(std::string_view _ucir)
+   * std::string s = Movement::from_u16(u);
+   * \endcode
+   * @param _us Unsigned short of notation: `FFFFTTTTTTSSSSSS` where `F`=Flag ; `T`=Target ; `S`=Start
+   * @return Corresponding UCI movement following the format `crCRp` where `c`=start column ; `r`=start row ; `C`=target column ; `R`=target row ; `p`=promotion (can be omitted)
+   * @see Movement::write_uci
+   */
+  std::string from_u16(const move& _us) noexcept;
+
+  /**
+   * @brief Finds the legal movement a Standard Algebraic Notation movement stands for. \n
+   * Check, mate and annotation suffixes are ignored, and a few common deviations are accepted: castling written with zeros, long algebraic movements such as `Ng1-f3`, promotions without `=`.
+   * \code {.cpp}
+   * board.make_move(Movement::from_san(board, "Nf3"));
+   * \endcode
+   * @param board The position the movement is played from
+   * @param _san Any SAN movement, such as `e4`, `Nbd7`, `exd8=Q+` or `O-O-O`
+   * @return The movement, `0` if no legal movement or more than one matches
+   */
+  move from_san(const Board& board, std::string_view _san) noexcept;
+
+  /**
+   * @brief Finds the legal movement a Standard Algebraic Notation movement stands for, among legal movements already generated
+   * @param board The position the movement is played from
+   * @param _san Any SAN movement
+   * @param legal The legal movements of `board`, as generated by \ref Board::generate_legal_moves "Board::generate_legal_moves"
+   * @overload
+   */
+  move from_san(const Board& board, std::string_view _san, const MoveList& legal) noexcept;
+
+  /**
+   * @brief Writes a legal movement in Standard Algebraic Notation to a caller-supplied buffer, without allocating. \n
+   * The starting column or row is only given when another piece of the same type could reach the same square, and `+` or `#` is appended for check or mate.
+   * \code {.cpp}
+   * char san[Movement::MAX_SAN_LENGTH];
+   * size_t length = Movement::write_san(board, mv, san, sizeof(san));
+   * \endcode
+   * @param board The position the movement is played from, played on then taken back to find out about check and mate
+   * @param _m A legal movement of the position
+   * @param buffer Where the movement is written, followed by a null character
+   * @param size The size of the buffer, \ref Movement::MAX_SAN_LENGTH "MAX_SAN_LENGTH" always being enough
+   * @return The length of the movement, null character excluded, or `0` if the buffer is too small
+   */
+  size_t write_san(Board& board, const move& _m, char* buffer, size_t size) noexcept;
+
+  /**
+   * @brief Converts a legal movement to Standard Algebraic Notation
+   * \code {.cpp}
+   * std::string s = Movement::to_san(board, Movement::from_uci("g1f3")); // "Nf3"
+   * \endcode
+   * @param board The position the movement is played from, left as it was
+   * @param _m A legal movement of the position
+   * @see Movement::write_san
+   */
+  std::string to_san(Board& board, const move& _m) noexcept;
+}
+
+/**
+ * @brief A list of moves with inline storage, used instead of `std::vector<Movement::move>` so that generating moves never allocates
+ * \code {.cpp}
+ * MoveList moves;
+ * moves.push_back(Movement::from_uci("e2e4"));
+ * for(const Movement::move& mv : moves) {}
+ * \endcode
+ * A position has at most 218 legal moves, so \ref MoveList::CAPACITY "MoveList::CAPACITY" is never reached.
+ */
+class MoveList {
+  public:
+  /// @brief The number of moves that fit in the list
+  static constexpr size_t CAPACITY = 256;
+
+  /**
+   * @brief Appends a move at the end of the list
+   * @param _m Any movement
+   */
+  void push_back(const Movement::move& _m) noexcept { this->moves[this->count++] = _m; }
+
+  /**
+   * @brief Empties the list, without touching the stored moves
+   */
+  void clear() noexcept { this->count = 0; }
+
+  /**
+   * @brief Checks whether a move belongs to the list
+   * @param _m Any movement
+   * @return `true` if `_m` was found
+   */
+  [[nodiscard]] bool contains(const Movement::move& _m) const noexcept {
+    for(size_t i = 0; i < this->count; i++) {
+      if(this->moves[i] == _m) return true;
+    }
+    return false;
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return this->count; }
+  [[nodiscard]] bool empty() const noexcept { return this->count == 0; }
+
+  Movement::move& operator[](size_t i) noexcept { return this->moves[i]; }
+  const Movement::move& operator[](size_t i) const noexcept { return this->moves[i]; }
+
+  Movement::move* begin() noexcept { return this->moves; }
+  Movement::move* end() noexcept { return this->moves + this->count; }
+  [[nodiscard]] const Movement::move* begin() const noexcept { return this->moves; }
+  [[nodiscard]] const Movement::move* end() const noexcept { return this->moves + this->count; }
+
+  private:
+  /// @brief Left uninitialized, only the first \ref MoveList::count "count" items are meaningful
+  Movement::move moves[CAPACITY];
+  size_t count = 0;
+};
+
+#endif
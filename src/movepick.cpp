@@ -0,0 +1,136 @@
+#include"movepick.hpp"
+
+MovePicker::MovePicker(const Board& board, Movement::move tt_move, const Movement::move (&killers)[2], Movement::move counter_move, const History& history) noexcept
+  : board(board), history(&history), tt_move(tt_move), killers{ killers[0], killers[1] }, counter_move(counter_move) {
+  if(this->tt_move != 0 && !this->board.is_legal(this->tt_move)) this->tt_move = 0;
+}
+
+MovePicker::MovePicker(const Board& board, Movement::move tt_move) noexcept : board(board), quiescence(true), tt_move(tt_move) {
+  if(this->tt_move == 0 || !this->board.is_legal(this->tt_move)) {
+    this->tt_move = 0;
+    return;
+  }
+  const Piece::Type promotion = Movement::promotion_of(this->tt_move);
+  if(promotion == Piece::Type::NUL ? !this->board.is_capture(this->tt_move) : promotion != Piece::Type::QUEEN) this->tt_move = 0;
+}
+
+bool MovePicker::is_new_quiet(const Movement::move& _m) const noexcept {
+  return _m != 0 && _m != this->tt_move && Movement::promotion_of(_m) == Piece::Type::NUL && this->board.is_legal(_m) && !this->board.is_capture(_m);
+}
+
+bool MovePicker::is_losing(const Movement::move& _m) const noexcept {
+  // Underpromotions are almost never better than promoting to a queen
+  const Piece::Type promotion = Movement::promotion_of(_m);
+  if(promotion != Piece::Type::NUL && promotion != Piece::Type::QUEEN) return true;
+  return !this->board.see(_m, 0);
+}
+
+Movement::move MovePicker::pick_best() noexcept {
+  if(this->current >= this->moves.size()) return 0;
+
+  size_t best = this->current;
+  for(size_t i = this->current + 1; i < this->moves.size(); i++) {
+    if(this->scores[i] > this->scores[best]) best = i;
+  }
+
+  const Movement::move mv = this->moves[best];
+  const int score = this->scores[best];
+  this->moves[best] = this->moves[this->current];
+  this->scores[best] = this->scores[this->current];
+  this->moves[this->current] = mv;
+  this->scores[this->current] = score;
+  return this->moves[this->current++];
+}
+
+Movement::move MovePicker::next() noexcept {
+  const State& s = this->board.get_state();
+
+  switch(this->stage) {
+    case Stage::TT_MOVE:
+      this->stage = Stage::GENERATE_CAPTURES;
+      if(this->tt_move != 0) return this->tt_move;
+      [[fallthrough]];
+
+    case Stage::GENERATE_CAPTURES: {
+      this->board.generate_legal_moves(&this->moves, Board::Generation::CAPTURES);
+      this->current = 0;
+      for(size_t i = 0; i < this->moves.size(); i++) {
+        const Movement::move mv = this->moves[i];
+        const Piece::Type victim = Piece::get_type(s.get_board()[(mv >> 6) & 0b111111]);
+        const Piece::Type attacker = Piece::get_type(s.get_board()[mv & 0b111111]);
+        // En passant captures leave the target square empty, the victim is a pawn. A promotion counts as taking the piece it becomes
+        int score = this->board.is_capture(mv) ? Board::SEE_VALUES[victim == Piece::Type::NUL ? Piece::Type::PAWN : victim] * 10 - Board::SEE_VALUES[attacker] / 10 : 0;
+        score += Board::SEE_VALUES[Movement::promotion_of(mv)] * 10;
+        this->scores[i] = score;
+      }
+      this->stage = Stage::GOOD_CAPTURES;
+      [[fallthrough]];
+    }
+
+    case Stage::GOOD_CAPTURES: {
+      Movement::move mv;
+      while((mv = this->pick_best()) != 0) {
+        if(mv == this->tt_move) continue;
+        if(this->quiescence && Movement::promotion_of(mv) != Piece::Type::NUL && Movement::promotion_of(mv) != Piece::Type::QUEEN) continue;
+        if(this->is_losing(mv)) {
+          // The quiescence search only resolves exchanges, a capture losing material there is not worth searching
+          if(!this->quiescence) this->bad_captures.push_back(mv);
+          continue;
+        }
+        return mv;
+      }
+      if(this->quiescence) {
+        this->stage = Stage::DONE;
+        return 0;
+      }
+      this->stage = Stage::FIRST_KILLER;
+      [[fallthrough]];
+    }
+
+    case Stage::FIRST_KILLER:
+      this->stage = Stage::SECOND_KILLER;
+      if(this->is_new_quiet(this->killers[0])) return this->killers[0];
+      this->killers[0] = 0;
+      [[fallthrough]];
+
+    case Stage::SECOND_KILLER:
+      this->stage = Stage::COUNTER_MOVE;
+      if(this->killers[1] != this->killers[0] && this->is_new_quiet(this->killers[1])) return this->killers[1];
+      this->killers[1] = 0;
+      [[fallthrough]];
+
+    case Stage::COUNTER_MOVE:
+      this->stage = Stage::GENERATE_QUIETS;
+      if(this->counter_move != this->killers[0] && this->counter_move != this->killers[1] && this->is_new_quiet(this->counter_move)) return this->counter_move;
+      this->counter_move = 0;
+      [[fallthrough]];
+
+    case Stage::GENERATE_QUIETS: {
+      this->board.generate_legal_moves(&this->moves, Board::Generation::QUIETS);
+      this->current = 0;
+      const Piece::Color us = *s.get_ply_player();
+      for(size_t i = 0; i < this->moves.size(); i++) this->scores[i] = this->history->get(us, this->moves[i]);
+      this->stage = Stage::QUIETS;
+      [[fallthrough]];
+    }
+
+    case Stage::QUIETS: {
+      Movement::move mv;
+      while((mv = this->pick_best()) != 0) {
+        if(!this->already_picked(mv)) return mv;
+      }
+      this->stage = Stage::BAD_CAPTURES;
+      [[fallthrough]];
+    }
+
+    case Stage::BAD_CAPTURES:
+      if(this->bad_current < this->bad_captures.size()) return this->bad_captures[this->bad_current++];
+      this->stage = Stage::DONE;
+      [[fallthrough]];
+
+    case Stage::DONE:
+      break;
+  }
+
+  return 0;
+}
@@ -0,0 +1,150 @@
+#ifndef MOVEPICK_HPP
+#define MOVEPICK_HPP
+
+#pragma once
+#include<cstdlib>
+#include<cstring>
+#include"board.hpp"
+#include"movement.hpp"
+#include"piece.hpp"
+
+/**
+ * @brief How often each quiet move, by side to move, origin and target square, refuted the positions it was tried in
+ * \code {.cpp}
+ * History history;
+ * history.update(Piece::Color::WHITE, mv, depth * depth); // mv caused a beta cutoff
+ * int score = history.get(Piece::Color::WHITE, mv);
+ * \endcode
+ */
+class History {
+  public:
+  /// @brief Scores stay within `[-MAX, MAX]`
+  static constexpr int MAX = 16384;
+
+  /**
+   * @brief Gets the score of a quiet move
+   * @param color The player making the move
+   * @param _m Any movement
+   * @return A score within `[-MAX, MAX]`, higher for moves that often caused cutoffs
+   */
+  [[nodiscard]] int get(Piece::Color color, const Movement::move& _m) const noexcept {
+    return this->table[color >> 3][_m & 0b111111][(_m >> 6) & 0b111111];
+  }
+
+  /**
+   * @brief Rewards or punishes a quiet move. \n
+   * The change shrinks as the score nears its bound, so that scores never saturate and recent results keep mattering.
+   * @param color The player making the move
+   * @param _m Any movement
+   * @param bonus Positive when the move caused a cutoff, negative when it was tried before the one that did
+   */
+  void update(Piece::Color color, const Movement::move& _m, int bonus) noexcept {
+    int& entry = this->table[color >> 3][_m & 0b111111][(_m >> 6) & 0b111111];
+    if(bonus > MAX) bonus = MAX;
+    if(bonus < -MAX) bonus = -MAX;
+    entry += bonus - entry * std::abs(bonus) / MAX;
+  }
+
+  /**
+   * @brief Forgets every score
+   */
+  void clear() noexcept { std::memset(this->table, 0, sizeof(this->table)); }
+
+  private:
+  int table[2][64][64] = {};
+};
+
+/**
+ * @brief Hands out the legal moves of a position one at a time, best guesses first, generating them in stages. \n
+ * Most nodes are refuted by the transposition table's move or a capture, in which case the quiet moves are never generated.
+ * \code {.cpp}
+ * MovePicker picker(board, tt_move, killers[ply], counter_move, history);
+ * Movement::move mv;
+ * while((mv = picker.next()) != 0) {}
+ * \endcode
+ * The order is: the transposition table's move, the captures that do not lose material according to \ref Board::see "Board::see" by most valuable victim then least valuable attacker,
+ * the two killer moves, the counter-move, the other quiet moves by \ref History "History" score, and the losing captures last.
+ */
+class MovePicker {
+  public:
+  /**
+   * @brief Creates a picker returning every legal move, for the main search
+   * @param board The position, which must not change while moves are picked
+   * @param tt_move The transposition table's move, `0` if none. Checked for legality
+   * @param killers The two quiet moves that last caused a cutoff at this ply, in other positions. Checked for legality
+   * @param counter_move The quiet move that last refuted the opponent's previous move, `0` if none. Checked for legality
+   * @param history The quiet moves' scores
+   */
+  MovePicker(const Board& board, Movement::move tt_move, const Movement::move (&killers)[2], Movement::move counter_move, const History& history) noexcept;
+
+  /**
+   * @brief Creates a picker returning only the captures and queen promotions that do not lose material, for the quiescence search
+   * @param board The position, which must not change while moves are picked
+   * @param tt_move The transposition table's move, `0` if none. Only returned when legal and a capture
+   */
+  MovePicker(const Board& board, Movement::move tt_move) noexcept;
+
+  /**
+   * @brief Gets the next move to try
+   * @return A legal move never returned before, `0` once every move has been returned
+   */
+  Movement::move next() noexcept;
+
+  private:
+  enum class Stage {
+    TT_MOVE,
+    GENERATE_CAPTURES,
+    GOOD_CAPTURES,
+    FIRST_KILLER,
+    SECOND_KILLER,
+    COUNTER_MOVE,
+    GENERATE_QUIETS,
+    QUIETS,
+    BAD_CAPTURES,
+    DONE,
+  };
+
+  /**
+   * @brief Moves the best scored of the moves not returned yet to the front, a selection sort done lazily as the moves are asked for
+   * @return The move, `0` if none is left
+   */
+  Movement::move pick_best() noexcept;
+
+  /**
+   * @brief Checks whether a move is a legal quiet move that the stages before it did not already return, for the killer and counter-move stages
+   */
+  [[nodiscard]] bool is_new_quiet(const Movement::move& _m) const noexcept;
+
+  /**
+   * @brief Checks whether a capture loses material once every recapture is played out, underpromotions counting as losing
+   */
+  [[nodiscard]] bool is_losing(const Movement::move& _m) const noexcept;
+
+  /**
+   * @brief Checks whether a move was already returned by the transposition table, killer or counter-move stages
+   */
+  [[nodiscard]] bool already_picked(const Movement::move& _m) const noexcept {
+    return _m == this->tt_move || _m == this->killers[0] || _m == this->killers[1] || _m == this->counter_move;
+  }
+
+  const Board& board;
+  const History* history = nullptr;
+  Stage stage = Stage::TT_MOVE;
+  /// @brief Only captures and queen promotions are returned
+  bool quiescence = false;
+
+  /// @brief Set to `0` by the stages that find them unusable, so that later stages do not skip a move nobody returned
+  Movement::move tt_move = 0;
+  Movement::move killers[2] = {};
+  Movement::move counter_move = 0;
+
+  /// @brief The moves of the current stage, `moves[current]` onwards not returned yet
+  MoveList moves;
+  int scores[MoveList::CAPACITY];
+  size_t current = 0;
+  /// @brief Captures put aside by the good captures stage, returned after the quiet moves
+  MoveList bad_captures;
+  size_t bad_current = 0;
+};
+
+#endif
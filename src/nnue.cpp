@@ -0,0 +1,294 @@
+#include<algorithm>
+#include<cstring>
+
+#include"nnue.hpp"
+
+#if __has_include(<sys/mman.h>)
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#define SAPHIRSCHESS_MMAP
+#else
+#include<fstream>
+#include<new>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include<immintrin.h>
+#define SAPHIRSCHESS_X86_KERNELS
+#endif
+
+namespace {
+  constexpr size_t HEADER_SIZE = 2 * sizeof(std::uint32_t);
+  constexpr size_t FILE_SIZE = HEADER_SIZE +
+    NNUE::HALF_DIMENSIONS * sizeof(std::int16_t) + NNUE::FEATURES * NNUE::HALF_DIMENSIONS * sizeof(std::int16_t) +
+    NNUE::HIDDEN * sizeof(std::int32_t) + NNUE::HIDDEN * 2 * NNUE::HALF_DIMENSIONS +
+    NNUE::HIDDEN * sizeof(std::int32_t) + NNUE::HIDDEN * NNUE::HIDDEN +
+    sizeof(std::int32_t) + NNUE::HIDDEN;
+
+  // ---------------- Kernels ----------------
+  // Row operations work on HALF_DIMENSIONS values, affine transforms on inputs that are a multiple of 32
+
+  using RowKernel = void (*)(std::int16_t* accumulator, const std::int16_t* row) noexcept;
+  using AffineKernel = void (*)(const std::uint8_t* input, size_t inputs, const std::int8_t* weights, const std::int32_t* biases, std::int32_t* output, size_t outputs) noexcept;
+
+  struct Kernels {
+    const char* name;
+    RowKernel add_row;
+    RowKernel sub_row;
+    AffineKernel affine;
+  };
+
+  void add_row_scalar(std::int16_t* accumulator, const std::int16_t* row) noexcept {
+    for(size_t i = 0; i < NNUE::HALF_DIMENSIONS; i++) accumulator[i] = static_cast<std::int16_t>(accumulator[i] + row[i]);
+  }
+
+  void sub_row_scalar(std::int16_t* accumulator, const std::int16_t* row) noexcept {
+    for(size_t i = 0; i < NNUE::HALF_DIMENSIONS; i++) accumulator[i] = static_cast<std::int16_t>(accumulator[i] - row[i]);
+  }
+
+  void affine_scalar(const std::uint8_t* input, size_t inputs, const std::int8_t* weights, const std::int32_t* biases, std::int32_t* output, size_t outputs) noexcept {
+    for(size_t o = 0; o < outputs; o++) {
+      std::int32_t sum = biases[o];
+      const std::int8_t* row = weights + o * inputs;
+      for(size_t i = 0; i < inputs; i++) sum += input[i] * row[i];
+      output[o] = sum;
+    }
+  }
+
+#ifdef SAPHIRSCHESS_X86_KERNELS
+  __attribute__((target("avx2"))) void add_row_avx2(std::int16_t* accumulator, const std::int16_t* row) noexcept {
+    for(size_t i = 0; i < NNUE::HALF_DIMENSIONS; i += 16) {
+      auto* a = reinterpret_cast<__m256i*>(accumulator + i);
+      _mm256_storeu_si256(a, _mm256_add_epi16(_mm256_loadu_si256(a), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i))));
+    }
+  }
+
+  __attribute__((target("avx2"))) void sub_row_avx2(std::int16_t* accumulator, const std::int16_t* row) noexcept {
+    for(size_t i = 0; i < NNUE::HALF_DIMENSIONS; i += 16) {
+      auto* a = reinterpret_cast<__m256i*>(accumulator + i);
+      _mm256_storeu_si256(a, _mm256_sub_epi16(_mm256_loadu_si256(a), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i))));
+    }
+  }
+
+  // Unsigned inputs times signed weights, summed by pairs into 16 bits then by quadruples into 32 bits.
+  // Inputs are at most 127, so a pair of products cannot saturate 16 bits
+  __attribute__((target("avx2"))) void affine_avx2(const std::uint8_t* input, size_t inputs, const std::int8_t* weights, const std::int32_t* biases, std::int32_t* output, size_t outputs) noexcept {
+    const __m256i ones = _mm256_set1_epi16(1);
+    for(size_t o = 0; o < outputs; o++) {
+      const std::int8_t* row = weights + o * inputs;
+      __m256i sum = _mm256_setzero_si256();
+      for(size_t i = 0; i < inputs; i += 32) {
+        const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        const __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(in, w), ones));
+      }
+      __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+      half = _mm_hadd_epi32(half, half);
+      half = _mm_hadd_epi32(half, half);
+      output[o] = biases[o] + _mm_cvtsi128_si32(half);
+    }
+  }
+
+  __attribute__((target("sse4.1"))) void add_row_sse41(std::int16_t* accumulator, const std::int16_t* row) noexcept {
+    for(size_t i = 0; i < NNUE::HALF_DIMENSIONS; i += 8) {
+      auto* a = reinterpret_cast<__m128i*>(accumulator + i);
+      _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i))));
+    }
+  }
+
+  __attribute__((target("sse4.1"))) void sub_row_sse41(std::int16_t* accumulator, const std::int16_t* row) noexcept {
+    for(size_t i = 0; i < NNUE::HALF_DIMENSIONS; i += 8) {
+      auto* a = reinterpret_cast<__m128i*>(accumulator + i);
+      _mm_storeu_si128(a, _mm_sub_epi16(_mm_loadu_si128(a), _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i))));
+    }
+  }
+
+  __attribute__((target("sse4.1"))) void affine_sse41(const std::uint8_t* input, size_t inputs, const std::int8_t* weights, const std::int32_t* biases, std::int32_t* output, size_t outputs) noexcept {
+    const __m128i ones = _mm_set1_epi16(1);
+    for(size_t o = 0; o < outputs; o++) {
+      const std::int8_t* row = weights + o * inputs;
+      __m128i sum = _mm_setzero_si128();
+      for(size_t i = 0; i < inputs; i += 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_maddubs_epi16(in, w), ones));
+      }
+      sum = _mm_hadd_epi32(sum, sum);
+      sum = _mm_hadd_epi32(sum, sum);
+      output[o] = biases[o] + _mm_cvtsi128_si32(sum);
+    }
+  }
+#endif
+
+  Kernels select_kernels() noexcept {
+#ifdef SAPHIRSCHESS_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return { "avx2", add_row_avx2, sub_row_avx2, affine_avx2 };
+    if(__builtin_cpu_supports("sse4.1")) return { "sse4.1", add_row_sse41, sub_row_sse41, affine_sse41 };
+#endif
+    return { "scalar", add_row_scalar, sub_row_scalar, affine_scalar };
+  }
+
+  const Kernels KERNELS = select_kernels();
+
+  // ---------------- Features ----------------
+
+  // Each side sees the board from its own side, black's squares being flipped vertically
+  constexpr int orient(int sq, Piece::Color perspective) noexcept {
+    return perspective == Piece::Color::WHITE ? sq : sq ^ 56;
+  }
+
+  inline size_t feature(int king, Piece::piece _p, int sq, Piece::Color perspective) noexcept {
+    const int piece_index = (Piece::get_type(_p) - 1) * 2 + (Piece::get_color(_p) != perspective);
+    return static_cast<size_t>(orient(king, perspective)) * 640 + piece_index * 64 + orient(sq, perspective);
+  }
+
+  constexpr std::uint8_t clipped_relu(std::int32_t x) noexcept {
+    return static_cast<std::uint8_t>(std::clamp<std::int32_t>(x, 0, 127));
+  }
+}
+
+const char* NNUE::simd_name() noexcept {
+  return KERNELS.name;
+}
+
+NNUE::Network::~Network() noexcept {
+  this->unload();
+}
+
+void NNUE::Network::unload() noexcept {
+  if(this->data == nullptr) return;
+#ifdef SAPHIRSCHESS_MMAP
+  if(this->mapped) munmap(const_cast<unsigned char*>(this->data), this->size);
+  else delete[] this->data;
+#else
+  delete[] this->data;
+#endif
+  this->data = nullptr;
+  this->size = 0;
+  this->mapped = false;
+}
+
+bool NNUE::Network::load(const std::string& path) noexcept {
+  this->unload();
+
+  const unsigned char* bytes = nullptr;
+#ifdef SAPHIRSCHESS_MMAP
+  const int fd = open(path.c_str(), O_RDONLY);
+  if(fd < 0) return false;
+  struct stat info{};
+  if(fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) != FILE_SIZE) {
+    close(fd);
+    return false;
+  }
+  void* mapping = mmap(nullptr, FILE_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapping == MAP_FAILED) return false;
+  // The feature transformer's rows are read in a random order, better have them all in memory from the start
+  madvise(mapping, FILE_SIZE, MADV_WILLNEED);
+  bytes = static_cast<const unsigned char*>(mapping);
+  this->mapped = true;
+#else
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if(!file || static_cast<size_t>(file.tellg()) != FILE_SIZE) return false;
+  auto* buffer = new(std::nothrow) unsigned char[FILE_SIZE];
+  if(buffer == nullptr) return false;
+  file.seekg(0);
+  if(!file.read(reinterpret_cast<char*>(buffer), FILE_SIZE)) {
+    delete[] buffer;
+    return false;
+  }
+  bytes = buffer;
+  this->mapped = false;
+#endif
+  this->data = bytes;
+  this->size = FILE_SIZE;
+
+  std::uint32_t header[2];
+  std::memcpy(header, bytes, HEADER_SIZE);
+  if(header[0] != MAGIC || header[1] != VERSION) {
+    this->unload();
+    return false;
+  }
+
+  // Every block starts at a multiple of its element size, so the weights are used in place
+  const unsigned char* cursor = bytes + HEADER_SIZE;
+  this->transformer_biases = reinterpret_cast<const std::int16_t*>(cursor);
+  cursor += HALF_DIMENSIONS * sizeof(std::int16_t);
+  this->transformer_weights = reinterpret_cast<const std::int16_t*>(cursor);
+  cursor += FEATURES * HALF_DIMENSIONS * sizeof(std::int16_t);
+  this->hidden1_biases = reinterpret_cast<const std::int32_t*>(cursor);
+  cursor += HIDDEN * sizeof(std::int32_t);
+  this->hidden1_weights = reinterpret_cast<const std::int8_t*>(cursor);
+  cursor += HIDDEN * 2 * HALF_DIMENSIONS;
+  this->hidden2_biases = reinterpret_cast<const std::int32_t*>(cursor);
+  cursor += HIDDEN * sizeof(std::int32_t);
+  this->hidden2_weights = reinterpret_cast<const std::int8_t*>(cursor);
+  cursor += HIDDEN * HIDDEN;
+  this->output_bias = reinterpret_cast<const std::int32_t*>(cursor);
+  cursor += sizeof(std::int32_t);
+  this->output_weights = reinterpret_cast<const std::int8_t*>(cursor);
+
+  return true;
+}
+
+void NNUE::Network::refresh(const State& s, Piece::Color perspective, Accumulator* accumulator) const noexcept {
+  std::int16_t* values = accumulator->values[perspective >> 3];
+  std::copy(this->transformer_biases, this->transformer_biases + HALF_DIMENSIONS, values);
+
+  const int king = Bitboard::lsb(s.get_pieces(Piece::Type::KING, perspective));
+  Bitboard::bitboard occupied = s.get_occupancy() & ~s.get_pieces(Piece::Type::KING, Piece::Color::WHITE) & ~s.get_pieces(Piece::Type::KING, Piece::Color::BLACK);
+  while(occupied) {
+    const int sq = Bitboard::pop_lsb(occupied);
+    KERNELS.add_row(values, this->transformer_weights + feature(king, s.get_board()[sq], sq, perspective) * HALF_DIMENSIONS);
+  }
+}
+
+void NNUE::Network::update(const Accumulator& previous, Accumulator* next, const Delta& delta, const State& s) const noexcept {
+  for(const Piece::Color perspective : { Piece::Color::WHITE, Piece::Color::BLACK }) {
+    const int index = perspective >> 3;
+    if(delta.refresh[index]) {
+      this->refresh(s, perspective, next);
+      continue;
+    }
+
+    std::int16_t* values = next->values[index];
+    std::copy(previous.values[index], previous.values[index] + HALF_DIMENSIONS, values);
+
+    const int king = Bitboard::lsb(s.get_pieces(Piece::Type::KING, perspective));
+    for(int i = 0; i < delta.removed; i++) {
+      if(Piece::get_type(delta.removed_pieces[i]) == Piece::Type::KING) continue;
+      KERNELS.sub_row(values, this->transformer_weights + feature(king, delta.removed_pieces[i], delta.removed_squares[i], perspective) * HALF_DIMENSIONS);
+    }
+    for(int i = 0; i < delta.added; i++) {
+      if(Piece::get_type(delta.added_pieces[i]) == Piece::Type::KING) continue;
+      KERNELS.add_row(values, this->transformer_weights + feature(king, delta.added_pieces[i], delta.added_squares[i], perspective) * HALF_DIMENSIONS);
+    }
+  }
+}
+
+int NNUE::Network::evaluate(const Accumulator& accumulator, Piece::Color side) const noexcept {
+  // The player to move's half comes first, so that the network always sees the position from the side that plays
+  alignas(64) std::uint8_t transformed[2 * HALF_DIMENSIONS];
+  const int us = side >> 3;
+  for(size_t i = 0; i < HALF_DIMENSIONS; i++) {
+    transformed[i] = clipped_relu(accumulator.values[us][i]);
+    transformed[HALF_DIMENSIONS + i] = clipped_relu(accumulator.values[us ^ 1][i]);
+  }
+
+  alignas(64) std::int32_t sums[HIDDEN];
+  alignas(64) std::uint8_t hidden1[HIDDEN];
+  alignas(64) std::uint8_t hidden2[HIDDEN];
+
+  KERNELS.affine(transformed, 2 * HALF_DIMENSIONS, this->hidden1_weights, this->hidden1_biases, sums, HIDDEN);
+  for(size_t i = 0; i < HIDDEN; i++) hidden1[i] = clipped_relu(sums[i] >> 6);
+
+  KERNELS.affine(hidden1, HIDDEN, this->hidden2_weights, this->hidden2_biases, sums, HIDDEN);
+  for(size_t i = 0; i < HIDDEN; i++) hidden2[i] = clipped_relu(sums[i] >> 6);
+
+  std::int32_t output;
+  KERNELS.affine(hidden2, HIDDEN, this->output_weights, this->output_bias, &output, 1);
+  return output / OUTPUT_SCALE;
+}
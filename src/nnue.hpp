@@ -0,0 +1,145 @@
+#ifndef NNUE_HPP
+#define NNUE_HPP
+
+#pragma once
+#include<cstddef>
+#include<cstdint>
+#include<string>
+#include"piece.hpp"
+#include"state.hpp"
+
+/**
+ * @brief Namespace holding the efficiently updatable neural network evaluation
+ * \code {.cpp}
+ * NNUE::Network network;
+ * if(network.load("saphirschess.nnue")) board.set_network(&network);
+ * int score = network.evaluate(board.get_accumulator(), *board.get_state().get_ply_player());
+ * \endcode
+ * The network is HalfKP 40960 -> 256x2 -> 32 -> 32 -> 1: each side's half of the first layer sees every non-king piece relative to its own king.
+ * That first layer is kept up to date in an \ref NNUE::Accumulator "Accumulator" by adding and subtracting the weights of the pieces a move changes, and only recomputed when a king moves.
+ * The other layers are small integer matrix products run with the widest SIMD instructions the CPU supports, picked at runtime.
+ */
+namespace NNUE {
+  /// @brief Number of inputs: king square x (5 piece types x 2 colors) x square
+  constexpr size_t FEATURES = 64 * 10 * 64;
+  /// @brief Outputs of the first layer, per side
+  constexpr size_t HALF_DIMENSIONS = 256;
+  /// @brief Outputs of each hidden layer
+  constexpr size_t HIDDEN = 32;
+  /// @brief The network's output is divided by this to get centipawns
+  constexpr int OUTPUT_SCALE = 16;
+
+  /// @brief First 4 bytes of a network file, "SCNN" read as a little-endian number
+  constexpr std::uint32_t MAGIC = 0x4E4E4353;
+  /// @brief Format version following the magic number
+  constexpr std::uint32_t VERSION = 1;
+
+  /**
+   * @brief The first layer's output for a position, one half per side
+   */
+  struct alignas(64) Accumulator {
+    /// @brief Indexed by color (`0` for white, `1` for black) then by neuron
+    std::int16_t values[2][HALF_DIMENSIONS];
+  };
+
+  /**
+   * @brief The pieces a move takes off and puts on the board, recorded by \ref Board::make_move "Board::make_move" to update an accumulator
+   */
+  struct Delta {
+    int removed = 0;
+    int added = 0;
+    Piece::piece removed_pieces[3] = {};
+    unsigned char removed_squares[3] = {};
+    Piece::piece added_pieces[3] = {};
+    unsigned char added_squares[3] = {};
+    /// @brief Set for the side whose king moved, every one of its features changing
+    bool refresh[2] = {};
+
+    void remove(Piece::piece _p, unsigned char sq) noexcept { this->removed_pieces[this->removed] = _p; this->removed_squares[this->removed++] = sq; }
+    void add(Piece::piece _p, unsigned char sq) noexcept { this->added_pieces[this->added] = _p; this->added_squares[this->added++] = sq; }
+  };
+
+  /**
+   * @brief The network's weights, mapped read-only from a file and shared by every thread
+   */
+  class Network {
+    public:
+    Network() noexcept = default;
+    ~Network() noexcept;
+
+    Network(const Network&) = delete;
+    Network& operator=(const Network&) = delete;
+
+    /**
+     * @brief Maps a network file into memory, replacing the network loaded before if any
+     * \code {.txt}
+     * u32 magic, u32 version
+     * i16 biases[256], i16 weights[40960][256]   feature transformer
+     * i32 biases[32],  i8 weights[32][512]       hidden layer 1
+     * i32 biases[32],  i8 weights[32][32]        hidden layer 2
+     * i32 bias,        i8 weights[32]            output
+     * \endcode
+     * Everything is little-endian, without padding.
+     * @param path The path of the file
+     * @return `false` if the file could not be read or is not a network of this architecture, no network being loaded then
+     */
+    bool load(const std::string& path) noexcept;
+
+    /**
+     * @brief Getter for whether a network is loaded
+     * @return `true` after a successful \ref NNUE::Network::load "load"
+     */
+    [[nodiscard]] bool is_loaded() const noexcept { return this->data != nullptr; }
+
+    /**
+     * @brief Computes one side's half of an accumulator from scratch
+     * @param s The position
+     * @param perspective The side whose half is computed
+     * @param accumulator The accumulator to fill
+     */
+    void refresh(const State& s, Piece::Color perspective, Accumulator* accumulator) const noexcept;
+
+    /**
+     * @brief Computes the accumulator of the position reached by a move from the one before it
+     * @param previous The accumulator before the move
+     * @param next The accumulator to fill
+     * @param delta The pieces the move changed
+     * @param s The position after the move
+     */
+    void update(const Accumulator& previous, Accumulator* next, const Delta& delta, const State& s) const noexcept;
+
+    /**
+     * @brief Runs the layers after the accumulator
+     * @param accumulator The accumulator of the position
+     * @param side The player to move
+     * @return A score in centipawns from the point of view of the player to move
+     */
+    [[nodiscard]] int evaluate(const Accumulator& accumulator, Piece::Color side) const noexcept;
+
+    private:
+    void unload() noexcept;
+
+    /// @brief The whole file, mapped or read into memory
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    /// @brief Whether \ref NNUE::Network::data "data" is a memory mapping rather than an allocation
+    bool mapped = false;
+
+    const std::int16_t* transformer_biases = nullptr;
+    const std::int16_t* transformer_weights = nullptr;
+    const std::int32_t* hidden1_biases = nullptr;
+    const std::int8_t* hidden1_weights = nullptr;
+    const std::int32_t* hidden2_biases = nullptr;
+    const std::int8_t* hidden2_weights = nullptr;
+    const std::int32_t* output_bias = nullptr;
+    const std::int8_t* output_weights = nullptr;
+  };
+
+  /**
+   * @brief Gets the instruction set the matrix products run with on this CPU
+   * @return `"avx2"`, `"sse4.1"` or `"scalar"`
+   */
+  const char* simd_name() noexcept;
+}
+
+#endif
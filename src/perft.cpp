@@ -0,0 +1,182 @@
+#include<bit>
+#include<new>
+#include<vector>
+
+#include"perft.hpp"
+
+namespace {
+  // Adds the moves of the subtree to the statistics of their ply
+  void collect_statistics(Board& board, size_t ply, std::vector<Perft::Statistics>* statistics) noexcept {
+    MoveList moves;
+    board.generate_legal_moves(&moves);
+    Perft::Statistics& stats = (*statistics)[ply];
+
+    for(const Movement::move& mv : moves) {
+      stats.nodes++;
+      if(Movement::is_capture(mv)) stats.captures++;
+      if(Movement::flag_of(mv) == Movement::Flag::EN_PASSANT) stats.en_passant++;
+      if(Movement::is_castle(mv)) stats.castles++;
+      if(Movement::is_promotion(mv)) stats.promotions++;
+
+      board.make_move(mv);
+      if(board.in_check()) stats.checks++;
+      if(ply + 1 < statistics->size()) collect_statistics(board, ply + 1, statistics);
+      board.unmake_move();
+    }
+  }
+
+  // Counts the leaves below each root move, one task per move at ply 2
+  std::vector<size_t> count_root_moves(const Board& board, const MoveList& root_moves, size_t depth, Perft::Table* table, ThreadPool& pool) noexcept {
+    std::vector<std::atomic<size_t>> counts(root_moves.size());
+    if(depth == 0) return std::vector<size_t>(root_moves.size(), 0);
+
+    std::vector<Board> boards(pool.size(), board);
+    Board splitter(board);
+
+    for(size_t i = 0; i < root_moves.size(); i++) {
+      const Movement::move root_move = root_moves[i];
+      if(depth == 1) {
+        counts[i] = 1;
+        continue;
+      }
+
+      splitter.make_move(root_move);
+      MoveList children;
+      splitter.generate_legal_moves(&children);
+      splitter.unmake_move();
+
+      for(const Movement::move& child_move : children) {
+        pool.submit([&boards, &counts, &pool, table, depth, i, root_move, child_move] {
+          Board& b = boards[pool.current_worker()];
+          b.make_move(root_move);
+          b.make_move(child_move);
+          counts[i].fetch_add(Perft::run(b, depth - 2, table), std::memory_order_relaxed);
+          b.unmake_move();
+          b.unmake_move();
+        });
+      }
+    }
+    pool.wait();
+
+    std::vector<size_t> result(root_moves.size());
+    for(size_t i = 0; i < root_moves.size(); i++) result[i] = counts[i].load();
+    return result;
+  }
+}
+
+Perft::Table::Table(size_t megabytes) noexcept {
+  size_t count = megabytes * 1024 * 1024 / sizeof(Entry);
+  if(count < 1) count = 1;
+  count = std::bit_floor(count);
+
+  this->entries.reset(new(std::nothrow) Entry[count]);
+  if(!this->entries) {
+    count = 1;
+    this->entries.reset(new Entry[count]);
+  }
+  this->mask = count - 1;
+  this->clear();
+}
+
+Perft::Table::Entry& Perft::Table::slot(Zobrist::key key, size_t depth) const noexcept {
+  return this->entries[(key ^ (depth * 0x9E3779B97F4A7C15ULL)) & this->mask];
+}
+
+bool Perft::Table::probe(Zobrist::key key, size_t depth, size_t* nodes) const noexcept {
+  const Entry& entry = this->slot(key, depth);
+  const std::uint64_t data = entry.data.load(std::memory_order_relaxed);
+  const std::uint64_t check = entry.check.load(std::memory_order_relaxed);
+
+  if((check ^ data) != key || (data & 0xFF) != depth) return false;
+  *nodes = data >> 8;
+  return true;
+}
+
+void Perft::Table::store(Zobrist::key key, size_t depth, size_t nodes) noexcept {
+  Entry& entry = this->slot(key, depth);
+  const std::uint64_t data = static_cast<std::uint64_t>(nodes) << 8 | (depth & 0xFF);
+  entry.check.store(key ^ data, std::memory_order_relaxed);
+  entry.data.store(data, std::memory_order_relaxed);
+}
+
+void Perft::Table::clear() noexcept {
+  for(size_t i = 0; i <= this->mask; i++) {
+    this->entries[i].check.store(0, std::memory_order_relaxed);
+    this->entries[i].data.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t Perft::run(Board& board, size_t depth, Table* table) noexcept {
+  if(depth == 0) return 1;
+
+  size_t positions = 0;
+  if(table != nullptr && depth > 1 && table->probe(board.get_key(), depth, &positions)) return positions;
+
+  MoveList moves;
+  board.generate_legal_moves(&moves);
+  // Bulk counting: every legal move leads to exactly one leaf
+  if(depth == 1) return moves.size();
+
+  for(const Movement::move& mv : moves) {
+    board.make_move(mv);
+    positions += run(board, depth - 1, table);
+    board.unmake_move();
+  }
+
+  if(table != nullptr && depth > 1) table->store(board.get_key(), depth, positions);
+  return positions;
+}
+
+size_t Perft::divide(Board& board, size_t depth, Table* table, std::ostream& out) noexcept {
+  if(depth == 0) return 1;
+
+  size_t positions = 0;
+
+  MoveList moves;
+  board.generate_legal_moves(&moves);
+  for(const Movement::move& mv : moves) {
+    board.make_move(mv);
+    const size_t count = run(board, depth - 1, table);
+    board.unmake_move();
+
+    out << Movement::from_u16(mv) << ": " << count << '\n';
+    positions += count;
+  }
+
+  out << "\nNodes searched: " << positions << std::endl;
+  return positions;
+}
+
+size_t Perft::run_parallel(const Board& board, size_t depth, Table* table, ThreadPool& pool) noexcept {
+  if(depth == 0) return 1;
+
+  MoveList moves;
+  board.generate_legal_moves(&moves);
+
+  size_t positions = 0;
+  for(const size_t count : count_root_moves(board, moves, depth, table, pool)) positions += count;
+  return positions;
+}
+
+size_t Perft::divide_parallel(const Board& board, size_t depth, Table* table, ThreadPool& pool, std::ostream& out) noexcept {
+  if(depth == 0) return 1;
+
+  MoveList moves;
+  board.generate_legal_moves(&moves);
+  const std::vector<size_t> counts = count_root_moves(board, moves, depth, table, pool);
+
+  size_t positions = 0;
+  for(size_t i = 0; i < moves.size(); i++) {
+    out << Movement::from_u16(moves[i]) << ": " << counts[i] << '\n';
+    positions += counts[i];
+  }
+
+  out << "\nNodes searched: " << positions << std::endl;
+  return positions;
+}
+
+std::vector<Perft::Statistics> Perft::statistics(Board& board, size_t depth) noexcept {
+  std::vector<Statistics> result(depth);
+  if(depth > 0) collect_statistics(board, 0, &result);
+  return result;
+}
@@ -0,0 +1,140 @@
+#ifndef PERFT_HPP
+#define PERFT_HPP
+
+#pragma once
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<memory>
+#include<ostream>
+#include<vector>
+#include"board.hpp"
+#include"threadpool.hpp"
+#include"zobrist.hpp"
+
+/**
+ * @brief Namespace used to count the leaves of the move tree, optionally caching subtree counts in a hash table
+ * \code {.cpp}
+ * Board board;
+ * Perft::Table table(64); // 64 MB
+ * size_t nodes = Perft::run(board, 6, &table);
+ * \endcode
+ */
+namespace Perft {
+  /**
+   * @brief A hash table mapping a (position, depth) pair to the number of leaves below it. \n
+   * Entries are written and read without locks: each one stores its key XOR-ed with its data, so that an entry torn by two threads writing at once fails the key check instead of returning a wrong count.
+   */
+  class Table {
+    public:
+    /**
+     * @brief Allocates a table
+     * @param megabytes The size of the table, rounded down to a power of two number of entries
+     */
+    explicit Table(size_t megabytes) noexcept;
+
+    /**
+     * @brief Looks up the number of leaves of a position
+     * @param key The Zobrist key of the position
+     * @param depth The remaining depth
+     * @param nodes Set to the stored count on success
+     * @return `true` if the count was found
+     */
+    bool probe(Zobrist::key key, size_t depth, size_t* nodes) const noexcept;
+
+    /**
+     * @brief Stores the number of leaves of a position, replacing whatever used the same slot
+     * @param key The Zobrist key of the position
+     * @param depth The remaining depth (lower than 256)
+     * @param nodes The number of leaves (lower than 2^56)
+     */
+    void store(Zobrist::key key, size_t depth, size_t nodes) noexcept;
+
+    /**
+     * @brief Empties the table
+     */
+    void clear() noexcept;
+
+    private:
+    struct Entry {
+      std::atomic<std::uint64_t> check;
+      std::atomic<std::uint64_t> data;
+    };
+
+    /**
+     * @brief Gets the slot of a (position, depth) pair, different depths of a position using different slots
+     */
+    [[nodiscard]] Entry& slot(Zobrist::key key, size_t depth) const noexcept;
+
+    std::unique_ptr<Entry[]> entries;
+    size_t mask = 0;
+  };
+
+  /**
+   * @brief Move counts of one ply of the tree, in the layout of the usual perft result tables
+   */
+  struct Statistics {
+    size_t nodes = 0;
+    size_t captures = 0;
+    size_t en_passant = 0;
+    size_t castles = 0;
+    size_t promotions = 0;
+    size_t checks = 0;
+  };
+
+  /**
+   * @brief Counts the leaves of the move tree. \n
+   * At depth 1 the size of the legal move list is returned without making the moves.
+   * @param board The board to search from, left unchanged
+   * @param depth The number of plies to look into
+   * @param table A table to cache subtree counts in, can be `nullptr`
+   * @return Amount of positions found
+   */
+  size_t run(Board& board, size_t depth, Table* table) noexcept;
+
+  /**
+   * @brief Counts the leaves of the move tree, printing the count below each root move in the `e2e4: 20` format used by other engines
+   * @param board The board to search from, left unchanged
+   * @param depth The number of plies to look into
+   * @param table A table to cache subtree counts in, can be `nullptr`
+   * @param out The stream to print to
+   * @return Amount of positions found
+   */
+  size_t divide(Board& board, size_t depth, Table* table, std::ostream& out) noexcept;
+
+  /**
+   * @brief Makes every move of the tree to count, for each ply, the moves of each kind. Much slower than \ref Perft::run "Perft::run" as nothing is bulk-counted or cached
+   * \code {.cpp}
+   * std::vector<Perft::Statistics> stats = Perft::statistics(board, 4);
+   * stats[3].checks; // 469 from the starting position
+   * \endcode
+   * @param board The board to search from, left unchanged
+   * @param depth The number of plies to look into
+   * @return One item per ply, `result[0]` being the root moves
+   */
+  std::vector<Statistics> statistics(Board& board, size_t depth) noexcept;
+
+  /**
+   * @brief Counts the leaves of the move tree on every worker of a pool. \n
+   * Each worker gets its own copy of `board`, and every move at ply 2 becomes a task so that the work stays balanced even when root moves have very different subtree sizes.
+   * \code {.cpp}
+   * ThreadPool pool(32);
+   * Perft::Table table(1024);
+   * size_t nodes = Perft::run_parallel(board, 7, &table, pool);
+   * \endcode
+   * @param board The board to search from
+   * @param depth The number of plies to look into
+   * @param table A table shared by every worker, can be `nullptr`
+   * @param pool The pool to run the subtrees on, must not be running other tasks
+   * @return Amount of positions found, the same as \ref Perft::run "Perft::run"
+   */
+  size_t run_parallel(const Board& board, size_t depth, Table* table, ThreadPool& pool) noexcept;
+
+  /**
+   * @brief Same as \ref Perft::divide "Perft::divide", with the subtrees counted on every worker of a pool
+   * @see Perft::run_parallel
+   */
+  size_t divide_parallel(const Board& board, size_t depth, Table* table, ThreadPool& pool, std::ostream& out) noexcept;
+}
+
+#endif
@@ -0,0 +1,286 @@
+#include<cstring>
+#include<memory>
+#include<vector>
+
+#include"mappedfile.hpp"
+#include"pgn.hpp"
+#include"threadpool.hpp"
+
+namespace {
+  enum class TokenKind {
+    /// @brief The inside of a `[Name "Value"]` tag
+    TAG,
+    MOVE,
+    RESULT,
+    END,
+  };
+
+  struct Token {
+    TokenKind kind;
+    std::string_view text;
+  };
+
+  bool is_space(char c) noexcept {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+  }
+
+  bool is_digit(char c) noexcept {
+    return c >= '0' && c <= '9';
+  }
+
+  /**
+   * @brief Splits PGN text into tags, moves and results, skipping everything the replay does not need
+   */
+  class Lexer {
+    public:
+    explicit Lexer(std::string_view text) noexcept : text(text) {}
+
+    Token next() noexcept {
+      while(this->cursor < this->text.size()) {
+        const char c = this->text[this->cursor];
+        if(is_space(c)) {
+          this->cursor++;
+        } else if(c == '{') {
+          this->skip_past('}');
+        } else if(c == ';' || (c == '%' && this->at_line_start())) {
+          this->skip_past('\n');
+        } else if(c == '(') {
+          this->skip_variation();
+        } else if(c == ')') {
+          // A parenthesis closing no variation
+          this->cursor++;
+        } else if(c == '$' || c == '.' || c == '!' || c == '?') {
+          // Numeric annotation glyphs, the dots of move numbers and annotations written apart from their move
+          this->cursor++;
+          while(this->cursor < this->text.size() && is_digit(this->text[this->cursor])) this->cursor++;
+        } else if(c == '[') {
+          const size_t start = this->cursor + 1;
+          this->skip_tag();
+          size_t end = this->cursor - (this->text[this->cursor - 1] == ']' ? 1 : 0);
+          return { TokenKind::TAG, this->text.substr(start, end - start) };
+        } else if(c == '*') {
+          this->cursor++;
+          return { TokenKind::RESULT, this->text.substr(this->cursor - 1, 1) };
+        } else {
+          const size_t start = this->cursor;
+          while(this->cursor < this->text.size() && !this->ends_word(this->text[this->cursor])) this->cursor++;
+          const std::string_view word = this->text.substr(start, this->cursor - start);
+          // A character ending words that no branch above handles, skipped so that the lexer always moves on
+          if(word.empty()) {
+            this->cursor++;
+            continue;
+          }
+          if(word == "1-0" || word == "0-1" || word == "1/2-1/2") return { TokenKind::RESULT, word };
+          if(!is_digit(c) || word.starts_with("0-0")) return { TokenKind::MOVE, word };
+          // A move number, possibly glued to its move as in `1.e4`
+          size_t digits = 0;
+          while(digits < word.size() && is_digit(word[digits])) digits++;
+          this->cursor = start + digits;
+        }
+      }
+      return { TokenKind::END, {} };
+    }
+
+    size_t cursor = 0;
+
+    private:
+    bool ends_word(char c) const noexcept {
+      return is_space(c) || c == '{' || c == '(' || c == ')' || c == ';' || c == '[' || c == '$' || (c == '.' && this->cursor < this->text.size() && is_digit(this->text[this->cursor - 1]));
+    }
+
+    bool at_line_start() const noexcept {
+      return this->cursor == 0 || this->text[this->cursor - 1] == '\n';
+    }
+
+    void skip_past(char c) noexcept {
+      const void* found = std::memchr(this->text.data() + this->cursor, c, this->text.size() - this->cursor);
+      this->cursor = found == nullptr ? this->text.size() : static_cast<size_t>(static_cast<const char*>(found) - this->text.data()) + 1;
+    }
+
+    void skip_tag() noexcept {
+      bool quoted = false;
+      while(++this->cursor < this->text.size()) {
+        const char c = this->text[this->cursor];
+        if(quoted && c == '\\') this->cursor++;
+        else if(c == '"') quoted = !quoted;
+        else if(!quoted && (c == ']' || c == '\n')) break;
+      }
+      if(this->cursor < this->text.size()) this->cursor++;
+    }
+
+    void skip_variation() noexcept {
+      size_t depth = 0;
+      while(this->cursor < this->text.size()) {
+        const char c = this->text[this->cursor];
+        if(c == '{') {
+          this->skip_past('}');
+          continue;
+        }
+        this->cursor++;
+        if(c == '(') depth++;
+        else if(c == ')' && --depth == 0) return;
+      }
+    }
+
+    std::string_view text;
+  };
+
+  /**
+   * @brief Splits a tag into its name and its value, quotes removed and escapes left as they are
+   */
+  void split_tag(std::string_view tag, std::string_view* name, std::string_view* value) noexcept {
+    size_t i = 0;
+    while(i < tag.size() && is_space(tag[i])) i++;
+    const size_t name_start = i;
+    while(i < tag.size() && !is_space(tag[i]) && tag[i] != '"') i++;
+    *name = tag.substr(name_start, i - name_start);
+
+    const size_t open = tag.find('"', i);
+    const size_t close = tag.rfind('"');
+    *value = open == std::string_view::npos || close <= open ? std::string_view() : tag.substr(open + 1, close - open - 1);
+  }
+
+  Pgn::Result parse_result(std::string_view text) noexcept {
+    if(text == "1-0") return Pgn::Result::WHITE_WINS;
+    if(text == "0-1") return Pgn::Result::BLACK_WINS;
+    if(text == "1/2-1/2") return Pgn::Result::DRAW;
+    return Pgn::Result::UNKNOWN;
+  }
+
+  /**
+   * @brief What a worker reuses from one game to the next
+   */
+  struct Worker {
+    Board board;
+    MoveList legal;
+    State start;
+    Pgn::Summary summary;
+  };
+
+  /**
+   * @brief Finds the result a game's moves end with, without replaying them
+   */
+  Pgn::Result find_result(Lexer lexer) noexcept {
+    while(true) {
+      const Token token = lexer.next();
+      if(token.kind == TokenKind::RESULT) return parse_result(token.text);
+      if(token.kind != TokenKind::MOVE) return Pgn::Result::UNKNOWN;
+    }
+  }
+
+  /**
+   * @brief Replays every game of a piece of a file
+   * @param offset Where the piece starts in the file, so that the games' offsets are the file's
+   */
+  void replay_games(Worker& worker, size_t index, std::string_view text, size_t offset, const Pgn::Callback& callback) noexcept {
+    Lexer lexer(text);
+    Token token = lexer.next();
+    while(token.kind != TokenKind::END) {
+      // A tag's text starts after its bracket
+      const size_t game_offset = offset + static_cast<size_t>(token.text.data() - text.data()) - (token.kind == TokenKind::TAG ? 1 : 0);
+
+      std::string_view fen, result_tag;
+      for(; token.kind == TokenKind::TAG; token = lexer.next()) {
+        std::string_view name, value;
+        split_tag(token.text, &name, &value);
+        if(name == "FEN") fen = value;
+        else if(name == "Result") result_tag = value;
+      }
+      worker.summary.games++;
+
+      bool failed = false;
+      if(fen.empty()) {
+        worker.board.set_state(worker.start);
+      } else {
+        State state;
+        failed = State::parse_fen(fen, &state) != State::FenError::NONE;
+        if(!failed) worker.board.set_state(state);
+      }
+
+      // The tags come before the moves, the marker ending the moves only counts when the tag is missing
+      Pgn::Result result = parse_result(result_tag);
+      if(result_tag.empty() || result == Pgn::Result::UNKNOWN) {
+        Lexer ahead = lexer;
+        ahead.cursor = static_cast<size_t>(token.text.data() - text.data());
+        result = token.kind == TokenKind::RESULT ? parse_result(token.text) : token.kind == TokenKind::MOVE ? find_result(ahead) : Pgn::Result::UNKNOWN;
+      }
+
+      size_t ply = 0;
+      for(; token.kind == TokenKind::MOVE; token = lexer.next()) {
+        if(failed) continue;
+        worker.board.generate_legal_moves(&worker.legal);
+        const Movement::move mv = Movement::from_san(worker.board, token.text, worker.legal);
+        if(mv == 0) {
+          failed = true;
+          continue;
+        }
+        callback(Pgn::Position{ worker.board, mv, token.text, result, ply, game_offset, index });
+        worker.board.make_move(mv);
+        ply++;
+      }
+      worker.summary.moves += ply;
+      if(failed) worker.summary.errors++;
+      else callback(Pgn::Position{ worker.board, 0, {}, result, ply, game_offset, index });
+
+      if(token.kind == TokenKind::RESULT) token = lexer.next();
+    }
+  }
+
+  /**
+   * @brief Finds the start of the first game beginning at or after an offset: a `[` starting a line that follows an empty line
+   * @return The offset of the `[`, or the size of the text if there is none
+   */
+  size_t next_game(std::string_view text, size_t from) noexcept {
+    while(from < text.size()) {
+      const void* found = std::memchr(text.data() + from, '\n', text.size() - from);
+      if(found == nullptr) break;
+      const size_t newline = static_cast<size_t>(static_cast<const char*>(found) - text.data());
+      from = newline + 1;
+      if(from >= text.size() || text[from] != '[') continue;
+
+      size_t previous = newline;
+      while(previous > 0 && (text[previous - 1] == ' ' || text[previous - 1] == '\t' || text[previous - 1] == '\r')) previous--;
+      if(previous == 0 || text[previous - 1] == '\n') return from;
+    }
+    return text.size();
+  }
+
+  void add(Pgn::Summary* total, const Pgn::Summary& summary) noexcept {
+    total->games += summary.games;
+    total->moves += summary.moves;
+    total->errors += summary.errors;
+  }
+}
+
+void Pgn::replay(std::string_view text, const Callback& callback, Summary* summary) noexcept {
+  Worker worker;
+  replay_games(worker, 0, text, 0, callback);
+  if(summary != nullptr) *summary = worker.summary;
+}
+
+bool Pgn::read(const std::string& path, const Options& options, const Callback& callback, Summary* summary) noexcept {
+  const MappedFile file(path);
+  if(!file.is_open()) return false;
+  const std::string_view text = file.view();
+
+  ThreadPool pool(options.threads);
+  std::vector<std::unique_ptr<Worker>> workers;
+  for(size_t i = 0; i < pool.size(); i++) workers.push_back(std::make_unique<Worker>());
+
+  const size_t chunk = options.chunk > 0 ? options.chunk : 1;
+  for(size_t begin = 0; begin < text.size();) {
+    const size_t end = text.size() - begin <= chunk ? text.size() : next_game(text, begin + chunk);
+    pool.submit([&, begin, end] {
+      const size_t index = pool.current_worker();
+      replay_games(*workers[index], index, text.substr(begin, end - begin), begin, callback);
+    });
+    begin = end;
+  }
+  pool.wait();
+
+  if(summary != nullptr) {
+    *summary = Summary();
+    for(const std::unique_ptr<Worker>& worker : workers) add(summary, worker->summary);
+  }
+  return true;
+}
@@ -0,0 +1,100 @@
+#ifndef PGN_HPP
+#define PGN_HPP
+
+#pragma once
+#include<cstddef>
+#include<functional>
+#include<string>
+#include<string_view>
+#include"board.hpp"
+#include"movement.hpp"
+
+/**
+ * @brief Namespace holding a reader replaying the games of PGN archives, spread over every core
+ * \code {.cpp}
+ * std::vector<size_t> white_wins(pool_size);
+ * Pgn::Summary summary;
+ * Pgn::read("games.pgn", Pgn::Options(), [&](const Pgn::Position& p) {
+ *   if(p.move != 0 && p.result == Pgn::Result::WHITE_WINS) white_wins[p.worker]++;
+ *   Zobrist::key key = p.board.get_key();
+ *   char fen[State::MAX_FEN_LENGTH];
+ *   p.board.get_state().write_fen(fen, sizeof(fen));
+ * }, &summary);
+ * \endcode
+ * The file is mapped and never copied: tags and moves are read in place, and each SAN move is resolved with \ref Movement::from_san "Movement::from_san".
+ * Comments, variations, numeric annotation glyphs and move numbers are skipped.
+ */
+namespace Pgn {
+  enum class Result {
+    WHITE_WINS,
+    BLACK_WINS,
+    DRAW,
+    /// @brief The game is unfinished, or its result is not given
+    UNKNOWN,
+  };
+
+  /**
+   * @brief A position reached in a game, given to the callback before the move played from it
+   */
+  struct Position {
+    /// @brief The board holding the position, its key and FEN being found with \ref Board::get_key "Board::get_key" and \ref State::write_fen "State::write_fen"
+    const Board& board;
+    /// @brief The move played from this position, `0` for the last position of the game
+    Movement::move move;
+    /// @brief The move as written in the file, empty for the last position of the game
+    std::string_view san;
+    /// @brief The game's result, from its `Result` tag or else from the marker ending its moves
+    Result result;
+    /// @brief The number of moves played since the start of the game
+    size_t ply;
+    /// @brief Where the game starts in the file, in bytes, identifying it uniquely
+    size_t game_offset;
+    /// @brief The index of the worker calling, lower than the number of threads, so that callers can keep a tally per worker instead of locking
+    size_t worker;
+  };
+
+  /// @brief Called for every position of every game, from several threads at once
+  using Callback = std::function<void(const Position&)>;
+
+  struct Options {
+    /// @brief The number of worker threads, `0` meaning one per hardware thread
+    size_t threads = 0;
+    /// @brief The size of the pieces of the file handed to a worker at once, in bytes, rounded up to the start of the next game
+    size_t chunk = 1 << 22;
+  };
+
+  /**
+   * @brief Totals over a whole file
+   */
+  struct Summary {
+    size_t games = 0;
+    /// @brief Moves replayed over every game
+    size_t moves = 0;
+    /// @brief Games stopped early by a move that is illegal or unreadable, or by an invalid `FEN` tag
+    size_t errors = 0;
+  };
+
+  /**
+   * @brief Replays every game of a PGN file. \n
+   * The file is cut into chunks at game boundaries, a game starting with a tag at the beginning of a line that follows an empty line.
+   * Each chunk is replayed by one worker, in order, so that the callbacks of a game follow the moves; games of different chunks are replayed concurrently in any order.
+   * A game stopped by an error still had its positions before the faulty move reported.
+   * @param path The PGN file
+   * @param options How to split the work
+   * @param callback Called for every position, must be safe to call from several threads
+   * @param summary Filled with the totals, can be `nullptr`
+   * @return `false` if the file could not be read
+   */
+  bool read(const std::string& path, const Options& options, const Callback& callback, Summary* summary) noexcept;
+
+  /**
+   * @brief Replays every game of a text on the calling thread
+   * @param text Any number of games in PGN
+   * @param callback Called for every position, with \ref Pgn::Position::worker "Position::worker" set to `0`
+   * @param summary Filled with the totals, can be `nullptr`
+   * @see Pgn::read
+   */
+  void replay(std::string_view text, const Callback& callback, Summary* summary) noexcept;
+}
+
+#endif
@@ -63,7 +63,7 @@ bool Piece::get_flag(const Piece::piece& _p, Piece::Flag _f) noexcept {
 }
 
 void Piece::set_type(Piece::piece& _p, Piece::Type type) noexcept {
-  _p &= 0b000;
+  _p &= ~0b111;
   _p |= static_cast<unsigned char>(type);
 }
 
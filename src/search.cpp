@@ -0,0 +1,329 @@
+#include<algorithm>
+#include<thread>
+
+#include"evaluate.hpp"
+#include"movepick.hpp"
+#include"search.hpp"
+
+namespace {
+  // Mate scores are relative to the root while searching, but stored relative to the node so that they stay correct wherever the position is reached again
+  int score_to_tt(int score, int ply) noexcept {
+    if(score >= Search::MATE_BOUND) return score + ply;
+    if(score <= -Search::MATE_BOUND) return score - ply;
+    return score;
+  }
+
+  int score_from_tt(int score, int ply) noexcept {
+    if(score >= Search::MATE_BOUND) return score - ply;
+    if(score <= -Search::MATE_BOUND) return score + ply;
+    return score;
+  }
+
+  // Only the owning thread writes its counter, a plain load and store avoids the cost of an atomic increment
+  void count_node(std::atomic<size_t>& nodes) noexcept {
+    nodes.store(nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  // Whether a stored result is enough to score the node without searching it
+  bool tt_cutoff(const TranspositionTable::Data& entry, int score, int alpha, int beta) noexcept {
+    return entry.bound == TranspositionTable::Bound::EXACT ||
+      (entry.bound == TranspositionTable::Bound::LOWER && score >= beta) ||
+      (entry.bound == TranspositionTable::Bound::UPPER && score <= alpha);
+  }
+}
+
+int Search::evaluate(const Board& board) noexcept {
+  const NNUE::Network* network = board.get_network();
+  if(network != nullptr) return network->evaluate(board.get_accumulator(), *board.get_state().get_ply_player());
+  return Evaluation::evaluate(board.get_state());
+}
+
+Search::Searcher::Searcher(const Board& board, TranspositionTable& table, size_t threads) noexcept : board(board), table(&table) {
+  this->board.set_prefetch_table(this->table);
+  this->set_threads(threads);
+}
+
+void Search::Searcher::set_threads(size_t threads) noexcept {
+  if(threads == 0) threads = std::thread::hardware_concurrency();
+  if(threads == 0) threads = 1;
+
+  this->pool.reset();
+  this->helpers.clear();
+  if(threads == 1) return;
+
+  this->pool = std::make_unique<ThreadPool>(threads - 1);
+  for(size_t i = 1; i < threads; i++) this->helpers.push_back(std::make_unique<Searcher>(this->board, *this->table));
+}
+
+void Search::Searcher::set_position(const Board& board) noexcept {
+  this->board = board;
+  this->board.set_prefetch_table(this->table);
+  this->board.set_network(this->network);
+}
+
+void Search::Searcher::set_network(const NNUE::Network* network) noexcept {
+  this->network = network;
+  this->board.set_network(network);
+}
+
+size_t Search::Searcher::total_nodes() const noexcept {
+  size_t total = this->nodes.load(std::memory_order_relaxed);
+  for(const std::unique_ptr<Searcher>& helper : this->helpers) total += helper->nodes.load(std::memory_order_relaxed);
+  return total;
+}
+
+bool Search::Searcher::should_stop() noexcept {
+  if(this->stopped) return true;
+
+  const size_t searched = this->nodes.load(std::memory_order_relaxed);
+  if(!this->limits.infinite && this->limits.nodes != 0 && searched >= this->limits.nodes) this->stopped = true;
+
+  // Reading the clock is much slower than searching a node, so it is only done every few thousand nodes
+  if((searched & CHECK_MASK) == 0) {
+    if(this->stop_requested.load(std::memory_order_relaxed)) this->stopped = true;
+    else if(!this->limits.infinite && this->clock_running() && this->time_manager.hard_limit_reached()) this->stopped = true;
+  }
+
+  return this->stopped;
+}
+
+bool Search::Searcher::clock_running() noexcept {
+  if(!this->ponder_clock) return true;
+  if(this->pondering.load(std::memory_order_relaxed)) return false;
+  this->ponder_clock = false;
+  this->time_manager.restart();
+  return true;
+}
+
+int Search::Searcher::quiescence(int alpha, int beta, int ply) noexcept {
+  if(this->should_stop()) return 0;
+  count_node(this->nodes);
+  this->pv_length[ply] = ply;
+  if(ply > this->seldepth) this->seldepth = ply;
+
+  const int stand_pat = evaluate(this->board);
+  if(ply >= MAX_PLY) return stand_pat;
+
+  const bool pv_node = beta - alpha > 1;
+  TranspositionTable::Data entry;
+  Movement::move tt_move = 0;
+  if(this->table->probe(this->board.get_key(), &entry)) {
+    tt_move = entry.move;
+    const int tt_score = score_from_tt(entry.score, ply);
+    if(!pv_node && tt_cutoff(entry, tt_score, alpha, beta)) return tt_score;
+  }
+
+  if(stand_pat >= beta) return stand_pat;
+  const int original_alpha = alpha;
+  if(stand_pat > alpha) alpha = stand_pat;
+
+  // Only the captures and queen promotions that do not lose material are searched
+  MovePicker picker(this->board, tt_move);
+
+  int best = stand_pat;
+  Movement::move best_move = 0;
+  Movement::move mv;
+  while((mv = picker.next()) != 0) {
+    this->board.make_move(mv);
+    const int score = -this->quiescence(-beta, -alpha, ply + 1);
+    this->board.unmake_move();
+    if(this->stopped) return 0;
+
+    if(score > best) {
+      best = score;
+      if(score > alpha) {
+        alpha = score;
+        best_move = mv;
+        if(alpha >= beta) break;
+      }
+    }
+  }
+
+  const TranspositionTable::Bound bound = best >= beta ? TranspositionTable::Bound::LOWER : best > original_alpha ? TranspositionTable::Bound::EXACT : TranspositionTable::Bound::UPPER;
+  this->table->store(this->board.get_key(), best_move, score_to_tt(best, ply), 0, bound);
+  return best;
+}
+
+int Search::Searcher::negamax(int alpha, int beta, int depth, int ply) noexcept {
+  if(depth <= 0) return this->quiescence(alpha, beta, ply);
+  if(this->should_stop()) return 0;
+
+  count_node(this->nodes);
+  this->pv_length[ply] = ply;
+  if(ply > this->seldepth) this->seldepth = ply;
+
+  if(ply > 0 && this->board.is_draw()) return 0;
+  if(ply >= MAX_PLY) return evaluate(this->board);
+
+  // Outside of the principal variation, a result stored from a deep enough search is trusted as is
+  const bool pv_node = beta - alpha > 1;
+  TranspositionTable::Data entry;
+  Movement::move tt_move = 0;
+  if(this->table->probe(this->board.get_key(), &entry)) {
+    tt_move = entry.move;
+    const int tt_score = score_from_tt(entry.score, ply);
+    if(!pv_node && ply > 0 && entry.depth >= depth && tt_cutoff(entry, tt_score, alpha, beta)) return tt_score;
+  }
+
+  const bool in_check = this->board.in_check();
+  // Check extension: a forcing line is not cut at the horizon right after a check
+  const int search_depth = in_check ? depth + 1 : depth;
+
+  // The stored move is the previous iteration's principal variation on the principal variation, and the move that refuted this position elsewhere
+  const Movement::move previous = this->board.get_last_move();
+  const int previous_target = (previous >> 6) & 0b111111;
+  const Movement::move counter_move = previous != 0 ? this->counter_moves[this->board.get_state().get_board()[previous_target]][previous_target] : 0;
+  MovePicker picker(this->board, tt_move, this->killers[ply], counter_move, this->history);
+
+  const Piece::Color us = *this->board.get_state().get_ply_player();
+  const int original_alpha = alpha;
+  int best = -INFINITE;
+  Movement::move best_move = 0;
+  size_t move_count = 0;
+  // The quiet moves searched without causing a cutoff, punished in the history when a later one does
+  MoveList quiets_tried;
+  Movement::move mv;
+  while((mv = picker.next()) != 0) {
+    const bool quiet = !Movement::is_capture(mv) && !Movement::is_promotion(mv);
+    this->board.make_move(mv);
+    move_count++;
+
+    // Principal variation search: the first move gets the full window, the others a null window that is only widened when they beat alpha
+    int score;
+    if(move_count == 1) {
+      score = -this->negamax(-beta, -alpha, search_depth - 1, ply + 1);
+    } else {
+      score = -this->negamax(-alpha - 1, -alpha, search_depth - 1, ply + 1);
+      if(score > alpha && score < beta) score = -this->negamax(-beta, -alpha, search_depth - 1, ply + 1);
+    }
+
+    this->board.unmake_move();
+    if(this->stopped) return 0;
+
+    if(score > best) {
+      best = score;
+      if(score > alpha) {
+        alpha = score;
+        best_move = mv;
+
+        this->pv[ply][ply] = mv;
+        for(int next = ply + 1; next < this->pv_length[ply + 1]; next++) this->pv[ply][next] = this->pv[ply + 1][next];
+        this->pv_length[ply] = this->pv_length[ply + 1] > ply + 1 ? this->pv_length[ply + 1] : ply + 1;
+
+        if(alpha >= beta) {
+          // A quiet refutation is likely to refute the positions reached by other moves at this ply, and to answer the same move again
+          if(quiet) {
+            if(this->killers[ply][0] != mv) {
+              this->killers[ply][1] = this->killers[ply][0];
+              this->killers[ply][0] = mv;
+            }
+            if(previous != 0) this->counter_moves[this->board.get_state().get_board()[previous_target]][previous_target] = mv;
+
+            const int bonus = depth * depth;
+            this->history.update(us, mv, bonus);
+            for(const Movement::move& tried : quiets_tried) this->history.update(us, tried, -bonus);
+          }
+          break;
+        }
+      }
+    }
+    if(quiet) quiets_tried.push_back(mv);
+  }
+  if(move_count == 0) return in_check ? -MATE + ply : 0;
+
+  const TranspositionTable::Bound bound = best >= beta ? TranspositionTable::Bound::LOWER : best > original_alpha ? TranspositionTable::Bound::EXACT : TranspositionTable::Bound::UPPER;
+  this->table->store(this->board.get_key(), best_move, score_to_tt(best, ply), depth, bound);
+  return best;
+}
+
+Search::Result Search::Searcher::search(const Limits& limits, const std::function<void(const Info&)>& on_iteration) noexcept {
+  this->limits = limits;
+  if(limits.infinite) this->time_manager.start({}, 0, 0);
+  else this->time_manager.start(limits.clock, limits.movetime, *this->board.get_state().get_fullmove_clock());
+  this->pondering.store(limits.ponder, std::memory_order_relaxed);
+  this->ponder_clock = limits.ponder;
+  this->table->new_search();
+
+  // Helpers search until told to stop, starting every other one a ply deeper so that the threads spread over different depths
+  for(size_t i = 0; i < this->helpers.size(); i++) {
+    Searcher* helper = this->helpers[i].get();
+    helper->board = this->board;
+    helper->limits = Limits();
+    helper->limits.infinite = true;
+    helper->time_manager.start({}, 0, 0);
+    helper->stop_requested.store(false, std::memory_order_relaxed);
+    helper->nodes.store(0, std::memory_order_relaxed);
+    const int first_depth = 1 + static_cast<int>(i % 2);
+    this->pool->submit([helper, first_depth] { helper->helper_result = helper->iterate(first_depth, {}); });
+  }
+
+  Result result = this->iterate(1, on_iteration);
+
+  for(const std::unique_ptr<Searcher>& helper : this->helpers) helper->stop();
+  if(this->pool) this->pool->wait();
+
+  // The deepest finished iteration is the most reliable, whichever thread finished it
+  for(const std::unique_ptr<Searcher>& helper : this->helpers) {
+    if(helper->helper_result.best_move != 0 && helper->helper_result.depth > result.depth) result = helper->helper_result;
+  }
+
+  result.nodes = this->total_nodes();
+  return result;
+}
+
+Search::Result Search::Searcher::iterate(int first_depth, const std::function<void(const Info&)>& on_iteration) noexcept {
+  this->stopped = false;
+  this->nodes.store(0, std::memory_order_relaxed);
+  this->previous_pv.clear();
+  std::fill(&this->killers[0][0], &this->killers[0][0] + (MAX_PLY + 1) * 2, 0);
+  std::fill(&this->counter_moves[0][0], &this->counter_moves[0][0] + 16 * 64, 0);
+  this->history.clear();
+
+  Result result;
+  MoveList root_moves;
+  this->board.generate_legal_moves(&root_moves);
+  if(root_moves.empty()) return result;
+  result.best_move = root_moves[0];
+
+  const int max_depth = this->limits.depth > 0 && this->limits.depth < MAX_PLY && !this->limits.infinite ? this->limits.depth : MAX_PLY;
+  for(int depth = first_depth < max_depth ? first_depth : max_depth; depth <= max_depth; depth++) {
+    this->seldepth = 0;
+    // A stop before the root is searched leaves the principal variation of the previous search behind
+    this->pv_length[0] = 0;
+
+    const int score = this->negamax(-INFINITE, INFINITE, depth, 0);
+    if(this->pv_length[0] == 0) break;
+    // A partial iteration is only trusted when nothing else is known, and never counts as finished
+    if(this->stopped) {
+      if(result.depth == 0 && root_moves.contains(this->pv[0][0])) result.best_move = this->pv[0][0];
+      break;
+    }
+
+    this->previous_pv.assign(this->pv[0], this->pv[0] + this->pv_length[0]);
+    result.best_move = this->previous_pv[0];
+    result.ponder_move = this->previous_pv.size() > 1 ? this->previous_pv[1] : 0;
+    result.score = score;
+    result.depth = depth;
+
+    if(on_iteration) {
+      Info info;
+      info.depth = depth;
+      info.seldepth = this->seldepth;
+      info.score = score;
+      info.nodes = this->total_nodes();
+      info.time = this->time_manager.elapsed();
+      info.pv = this->previous_pv;
+      on_iteration(info);
+    }
+
+    this->time_manager.update(result.best_move, score);
+    // Another iteration would most likely not finish before the hard limit, or change the best move
+    if(this->clock_running() && this->time_manager.soft_limit_reached()) break;
+    // A forced mate found within the searched depth will not get any shorter
+    if(!this->limits.infinite && score >= MATE_BOUND && MATE - score <= depth) break;
+    if(!this->limits.infinite && -score >= MATE_BOUND && MATE + score <= depth) break;
+  }
+
+  result.nodes = this->nodes.load(std::memory_order_relaxed);
+  return result;
+}
@@ -0,0 +1,252 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#pragma once
+#include<atomic>
+#include<cstddef>
+#include<functional>
+#include<memory>
+#include<vector>
+#include"board.hpp"
+#include"movepick.hpp"
+#include"threadpool.hpp"
+#include"timeman.hpp"
+#include"tt.hpp"
+
+/**
+ * @brief Namespace holding the alpha-beta search used to find the best move of a position
+ * \code {.cpp}
+ * TranspositionTable tt(16);
+ * Search::Searcher searcher(board, tt);
+ * Search::Limits limits;
+ * limits.depth = 8;
+ * Search::Result result = searcher.search(limits);
+ * std::string best = Movement::from_u16(result.best_move);
+ * \endcode
+ */
+namespace Search {
+  /// @brief The deepest the search can go, quiescence included
+  constexpr int MAX_PLY = 128;
+  /// @brief Bound larger than every score
+  constexpr int INFINITE = 32001;
+  /// @brief Score of a checkmate at the root, mates further away score `MATE - ply`
+  constexpr int MATE = 32000;
+  /// @brief Scores at or above this value are mates
+  constexpr int MATE_BOUND = MATE - MAX_PLY;
+  /// @brief The stop conditions needing a system call are only checked when the node count has none of these bits set
+  constexpr size_t CHECK_MASK = 2047;
+
+  /**
+   * @brief Checks whether a score is a mate, for either side
+   */
+  constexpr bool is_mate(int score) noexcept {
+    return score >= MATE_BOUND || score <= -MATE_BOUND;
+  }
+
+  /**
+   * @brief Converts a mate score into the number of moves until the mate
+   * @param score A score for which \ref Search::is_mate "Search::is_mate" holds
+   * @return The moves left to mate, negative when the player to move is getting mated
+   */
+  constexpr int mate_in(int score) noexcept {
+    return score > 0 ? (MATE - score + 1) / 2 : -(MATE + score) / 2;
+  }
+
+  /**
+   * @brief Evaluates a position statically, with the board's network when one is set and with the piece-square tables otherwise
+   * @param board The position to evaluate
+   * @return The score from the point of view of the player to move, in centipawns
+   */
+  int evaluate(const Board& board) noexcept;
+
+  /**
+   * @brief Conditions stopping the search, the first one reached wins. A field left to `0` does not limit anything
+   */
+  struct Limits {
+    /// @brief Maximum depth of the iterative deepening, in plies
+    int depth = 0;
+    /// @brief Maximum number of nodes searched by the calling thread, helper threads not counted
+    size_t nodes = 0;
+    /// @brief Fixed search time, in milliseconds, used instead of \ref Search::Limits::clock "clock"
+    size_t movetime = 0;
+    /// @brief The clock of the player to move, the time manager deciding how much of it to spend
+    TimeManager::Clock clock;
+    /// @brief Search until \ref Search::Searcher::stop "Searcher::stop" is called, ignoring every other limit
+    bool infinite = false;
+    /// @brief Ignore the time limit until \ref Search::Searcher::ponderhit "Searcher::ponderhit" is called, the opponent not having played the expected move yet
+    bool ponder = false;
+  };
+
+  /**
+   * @brief What is known after an iteration of the iterative deepening
+   */
+  struct Info {
+    int depth = 0;
+    /// @brief The deepest ply reached, quiescence included
+    int seldepth = 0;
+    /// @brief Score in centipawns from the point of view of the player to move, or a mate score
+    int score = 0;
+    /// @brief Nodes searched by every thread
+    size_t nodes = 0;
+    /// @brief Time spent since the search started, in milliseconds
+    size_t time = 0;
+    /// @brief The principal variation, starting with the best move
+    std::vector<Movement::move> pv;
+  };
+
+  /**
+   * @brief Outcome of a whole search
+   */
+  struct Result {
+    /// @brief The move to play, `0` if the position has no legal move
+    Movement::move best_move = 0;
+    /// @brief The expected reply to the best move, `0` if unknown
+    Movement::move ponder_move = 0;
+    int score = 0;
+    /// @brief The depth of the deepest iteration finished by any thread
+    int depth = 0;
+    /// @brief Nodes searched by every thread
+    size_t nodes = 0;
+  };
+
+  /**
+   * @brief Runs a negamax alpha-beta search with principal variation search, iterative deepening and a quiescence search over captures, on its own copy of a board. \n
+   * With more than one thread, the search is Lazy SMP: helper threads search the same root on their own copies of the board, and only cooperate through the shared transposition table.
+   */
+  class Searcher {
+    public:
+    /**
+     * @brief Creates a searcher for the current position of a board
+     * @param board The board to copy, history included so that repetitions are detected
+     * @param table The transposition table to read and fill, kept between searches so that later moves of the game benefit from it
+     * @param threads The number of threads searching, the calling one included. `0` uses every core
+     */
+    Searcher(const Board& board, TranspositionTable& table, size_t threads = 1) noexcept;
+
+    /**
+     * @brief Searches the position until a limit is reached
+     * @param limits When to stop
+     * @param on_iteration Called after every finished iteration, can be empty
+     * @return The best move found
+     */
+    Result search(const Limits& limits, const std::function<void(const Info&)>& on_iteration = {}) noexcept;
+
+    /**
+     * @brief Asks a running search to stop as soon as possible. Can be called from any thread. \n
+     * A request made before the search starts makes it stop at once, it holds until \ref Search::Searcher::clear_stop "Searcher::clear_stop" is called.
+     */
+    void stop() noexcept { this->stop_requested.store(true, std::memory_order_relaxed); }
+
+    /**
+     * @brief Forgets the last stop request, so that the searcher can be used again. Must not be called while a search is running
+     */
+    void clear_stop() noexcept { this->stop_requested.store(false, std::memory_order_relaxed); }
+
+    /**
+     * @brief Tells a search started with \ref Search::Limits::ponder "Limits::ponder" that the expected move was played, so that its time limits now apply, counted from the ponderhit. Can be called from any thread
+     */
+    void ponderhit() noexcept { this->pondering.store(false, std::memory_order_relaxed); }
+
+    /**
+     * @brief Replaces the position searched by the next searches. Must not be called while a search is running
+     * @param board The board to copy, history included so that repetitions are detected
+     */
+    void set_position(const Board& board) noexcept;
+
+    /**
+     * @brief Makes the next searches evaluate with a network instead of the piece-square tables. Must not be called while a search is running
+     * @param network A loaded network shared by every thread, `nullptr` to go back to the piece-square tables
+     */
+    void set_network(const NNUE::Network* network) noexcept;
+
+    /**
+     * @brief Changes the number of threads used by the next searches. Must not be called while a search is running
+     * @param threads The number of threads searching, the calling one included. `0` uses every core
+     */
+    void set_threads(size_t threads) noexcept;
+
+    /**
+     * @brief Getter for the number of threads searching
+     * @return The number of helper threads plus one
+     */
+    [[nodiscard]] size_t get_threads() const noexcept { return this->helpers.size() + 1; }
+
+    private:
+    /**
+     * @brief Runs the iterative deepening loop on the calling thread
+     * @param first_depth The depth of the first iteration, helpers starting deeper search different depths at the same time
+     * @param on_iteration Called after every finished iteration, can be empty
+     * @return The best move of the last finished iteration
+     */
+    Result iterate(int first_depth, const std::function<void(const Info&)>& on_iteration) noexcept;
+
+    /**
+     * @brief Counts the nodes searched so far by this searcher and its helpers
+     */
+    [[nodiscard]] size_t total_nodes() const noexcept;
+
+    /**
+     * @brief Scores a node with a full-window or null-window search
+     * @param alpha The lower bound
+     * @param beta The upper bound
+     * @param depth The remaining depth, quiescence starts below 1
+     * @param ply The distance from the root
+     * @return The score of the node from the point of view of the player to move
+     */
+    int negamax(int alpha, int beta, int depth, int ply) noexcept;
+
+    /**
+     * @brief Scores a node by only looking at captures until the position is quiet
+     * @see Search::Searcher::negamax
+     */
+    int quiescence(int alpha, int beta, int ply) noexcept;
+
+    /**
+     * @brief Checks whether the time limits apply, restarting the clock the first time a \ref Search::Searcher::ponderhit "ponderhit" is seen. Only called by the searching thread
+     * @return `false` while pondering
+     */
+    bool clock_running() noexcept;
+
+    /**
+     * @brief Checks the limits every few thousand nodes
+     * @return `true` if the search must stop
+     */
+    bool should_stop() noexcept;
+
+    Board board;
+    TranspositionTable* table;
+    const NNUE::Network* network = nullptr;
+    Limits limits;
+    TimeManager time_manager;
+    std::atomic<bool> stop_requested = false;
+    std::atomic<bool> pondering = false;
+    /// @brief Set while the clock has not been restarted since the ponder search started, only used by the searching thread
+    bool ponder_clock = false;
+    bool stopped = false;
+    /// @brief Only written by the searching thread, atomic so that the main thread can read it while helpers search
+    std::atomic<size_t> nodes = 0;
+    int seldepth = 0;
+
+    /// @brief The searchers run by the helper threads, empty when searching alone
+    std::vector<std::unique_ptr<Searcher>> helpers;
+    /// @brief One worker per helper
+    std::unique_ptr<ThreadPool> pool;
+    /// @brief What a helper found, read once it has been stopped
+    Result helper_result;
+
+    /// @brief The two last quiet moves that caused a cutoff at each ply, tried right after the captures by \ref MovePicker "MovePicker"
+    Movement::move killers[MAX_PLY + 1][2] = {};
+    /// @brief The quiet move that last refuted a move, by the piece that moved and its target square
+    Movement::move counter_moves[16][64] = {};
+    /// @brief Orders the remaining quiet moves
+    History history;
+
+    /// @brief The best line of the last finished iteration
+    std::vector<Movement::move> previous_pv;
+    /// @brief Triangular principal variation table, `pv[ply]` holding the best line found from that ply
+    Movement::move pv[MAX_PLY + 1][MAX_PLY + 1] = {};
+    int pv_length[MAX_PLY + 1] = {};
+  };
+}
+
+#endif
@@ -1,192 +1,273 @@
-#include<vector>
-#include<sstream>
+#include<array>
+#include<charconv>
+#include<cstring>
 
+#include"evaluate.hpp"
 #include"state.hpp"
 
 using std::string;
-using std::vector;
-
-inline vector<string> split_string(const string& str, char delimiter) {
-  vector<string> result;
-  std::stringstream ss(str);
-  string item;
-
-  while(std::getline(ss, item, delimiter)) {
-    result.push_back(item);
+using std::string_view;
+
+namespace {
+  // Splits off the next field, skipping the spaces before it
+  string_view next_field(string_view* rest) noexcept {
+    size_t start = 0;
+    while(start < rest->size() && (*rest)[start] == ' ') start++;
+    size_t end = start;
+    while(end < rest->size() && (*rest)[end] != ' ') end++;
+    const string_view field = rest->substr(start, end - start);
+    rest->remove_prefix(end);
+    return field;
   }
 
-  return result;
-};
-
-State::State(const string& fen_string) noexcept {
-  if(fen_string.empty())
-    return;
-  
-  this->board = std::vector<Piece::piece>(64);
-  this->castle_rights = std::vector<bool>(4);
-  castle_rights[0] = false;
-  castle_rights[1] = false;
-  castle_rights[2] = false;
-  castle_rights[3] = false;
-
-  size_t index = 56;
-  size_t string_index = 0;
-  vector<string> stages = split_string(fen_string, ' '); // split the fen string into multiple stages to treat each of them one at a time
-
-  const size_t FIRST_LEN = stages.at(0).size();
-  while(FIRST_LEN > string_index) {
-    char current_character = stages.at(0).at(string_index);
-
-    if(current_character == '/') { // new line
-      index -= 16;
-      string_index++;
-      continue;
-    }
-
-    if(current_character >= '1' && current_character <= '8') { // we're tracking a number
-      int num = current_character - '0'; // int conversion (trust me bro)
-      for(int i = 0; i < num; i++) {
-        this->board[index] = Piece::NIL;
-        index++;
-      }
-      string_index++;
-      continue;
+  // The piece of each FEN letter, Piece::NIL for any other character
+  constexpr std::array<Piece::piece, 256> PIECE_OF_LETTER = [] {
+    std::array<Piece::piece, 256> letters{};
+    constexpr char NAMES[] = "pnbrqk";
+    for(int type = Piece::Type::PAWN; type <= Piece::Type::KING; type++) {
+      letters[static_cast<unsigned char>(NAMES[type - 1])] = static_cast<Piece::piece>(type | Piece::Color::BLACK);
+      letters[static_cast<unsigned char>(NAMES[type - 1] - 'a' + 'A')] = static_cast<Piece::piece>(type | Piece::Color::WHITE);
     }
+    return letters;
+  }();
+
+  // The FEN letter of each piece value
+  constexpr char LETTER_OF_PIECE[17] = "-PNBRQK--pnbrqk-";
+
+  // Only plain digits are accepted, std::from_chars taking care of overflows
+  template<typename T>
+  bool parse_number(string_view field, T* value) noexcept {
+    if(field.empty()) return false;
+    const auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), *value);
+    return error == std::errc() && end == field.data() + field.size();
+  }
 
-    Piece::Color color = Piece::Color::WHITE;
-    if(current_character >= 'a' && current_character <= 'z') // Lowercase check
-      color = Piece::Color::BLACK;
+  // Writes the decimal digits of a number, returning the end of what was written
+  char* write_number(char* out, unsigned int value) noexcept {
+    char digits[10];
+    int count = 0;
+    do {
+      digits[count++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while(value != 0);
+    while(count > 0) *out++ = digits[--count];
+    return out;
+  }
+}
 
-    char lowercase_character = current_character;
-    if(current_character >= 'A' && current_character <= 'Z') lowercase_character = current_character + ('a' - 'A');
+State::State(string_view fen_string) noexcept {
+  // On failure the members keep their initial values: an empty board
+  State::parse_fen(fen_string, this);
+}
 
-    Piece::Type type;
-    switch(lowercase_character) {
-      case 'p': type = Piece::Type::PAWN; break;
-      case 'n': type = Piece::Type::KNIGHT; break;
-      case 'b': type = Piece::Type::BISHOP; break;
-      case 'r': type = Piece::Type::ROOK; break;
-      case 'q': type = Piece::Type::QUEEN; break;
-      case 'k': type = Piece::Type::KING; break;
-      default: type = Piece::Type::NUL; break;
-    };
+State::FenError State::parse_fen(string_view fen, State* state) noexcept {
+  State parsed{Empty{}};
+
+  const string_view placement = next_field(&fen);
+  int rank = 7, file = 0;
+  for(const char c : placement) {
+    if(c == '/') {
+      if(file != 8 || rank == 0) return FenError::PLACEMENT;
+      rank--;
+      file = 0;
+    } else if(c >= '1' && c <= '8') {
+      file += c - '0';
+      if(file > 8) return FenError::PLACEMENT;
+    } else {
+      const Piece::piece _p = PIECE_OF_LETTER[static_cast<unsigned char>(c)];
+      if(file >= 8 || _p == Piece::NIL) return FenError::PLACEMENT;
+      if(Piece::get_type(_p) == Piece::Type::PAWN && (rank == 0 || rank == 7)) return FenError::PLACEMENT;
+      // The bits of a piece value hold its color in the fourth one, so `_p >> 3` indexes the occupancy
+      const int sq = rank * 8 + file;
+      parsed.board[sq] = _p;
+      parsed.pieces[_p] |= Bitboard::square(sq);
+      parsed.occupancy[_p >> 3] |= Bitboard::square(sq);
+      file++;
+    }
+  }
+  if(rank != 0 || file != 8) return FenError::PLACEMENT;
+  if(Bitboard::count(parsed.get_pieces(Piece::Type::KING, Piece::Color::WHITE)) != 1 ||
+    Bitboard::count(parsed.get_pieces(Piece::Type::KING, Piece::Color::BLACK)) != 1) return FenError::KINGS;
+
+  const string_view side = next_field(&fen);
+  if(side == "w") parsed.ply_player = Piece::Color::WHITE;
+  else if(side == "b") parsed.ply_player = Piece::Color::BLACK;
+  else return FenError::SIDE;
+
+  const string_view castling = next_field(&fen);
+  if(castling.empty()) return FenError::CASTLING;
+  if(castling != "-") {
+    // The king's and rook's starting squares of each right, in KQkq order
+    constexpr char LETTERS[4] = { 'K', 'Q', 'k', 'q' };
+    constexpr unsigned char KINGS[4] = { 4, 4, 60, 60 };
+    constexpr unsigned char ROOKS[4] = { 7, 0, 63, 56 };
+    size_t next = 0;
+    for(const char c : castling) {
+      while(next < 4 && LETTERS[next] != c) next++;
+      if(next == 4) return FenError::CASTLING;
+      const Piece::Color color = next < 2 ? Piece::Color::WHITE : Piece::Color::BLACK;
+      if(parsed.board[KINGS[next]] != Piece::make(Piece::Type::KING, color) || parsed.board[ROOKS[next]] != Piece::make(Piece::Type::ROOK, color)) return FenError::CASTLING;
+      parsed.castle_rights |= 1 << next;
+      next++;
+    }
+  }
 
-    this->board[index] = Piece::make(type, color);
+  const string_view en_passant = next_field(&fen);
+  if(en_passant.empty()) return FenError::EN_PASSANT;
+  if(en_passant != "-") {
+    const bool white = parsed.ply_player == Piece::Color::WHITE;
+    if(en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h' || en_passant[1] != (white ? '6' : '3')) return FenError::EN_PASSANT;
+    const int sq = (en_passant[1] - '1') * 8 + (en_passant[0] - 'a');
+    const int forward = white ? -8 : 8;
+    // The pawn that just moved stands in front of the square, which it crossed, coming from the one behind
+    if(parsed.board[sq + forward] != Piece::make(Piece::Type::PAWN, white ? Piece::Color::BLACK : Piece::Color::WHITE) ||
+      parsed.board[sq] != Piece::NIL || parsed.board[sq - forward] != Piece::NIL) return FenError::EN_PASSANT;
+    parsed.en_passant = static_cast<unsigned char>(sq);
+  }
 
-    index++;
-    string_index++;
+  const string_view halfmove = next_field(&fen);
+  const string_view fullmove = next_field(&fen);
+  if(!halfmove.empty() || !fullmove.empty()) {
+    if(!parse_number(halfmove, &parsed.halfmove)) return FenError::HALFMOVE;
+    if(!parse_number(fullmove, &parsed.fullmove)) return FenError::FULLMOVE;
   }
+  if(!next_field(&fen).empty()) return FenError::TRAILING;
 
-  if(stages.at(1).at(0) == 'w') {
-    this->ply_player = Piece::Color::WHITE;
-  } else {
-    this->ply_player = Piece::Color::BLACK;
+  parsed.refresh_keys();
+  parsed.refresh_evaluation();
+  *state = parsed;
+  return FenError::NONE;
+}
+
+const char* State::describe(FenError error) noexcept {
+  switch(error) {
+    case FenError::NONE: return "valid";
+    case FenError::PLACEMENT: return "invalid piece placement";
+    case FenError::KINGS: return "each side needs exactly one king";
+    case FenError::SIDE: return "invalid side to move";
+    case FenError::CASTLING: return "invalid castling rights";
+    case FenError::EN_PASSANT: return "invalid en passant square";
+    case FenError::HALFMOVE: return "invalid halfmove clock";
+    case FenError::FULLMOVE: return "invalid fullmove number";
+    case FenError::TRAILING: return "unexpected text after the last field";
   }
+  return "unknown error";
+}
 
-  if(stages.at(2).at(0) != '-') {
-    for(char c : stages.at(2)) {
-      switch(c) {
-        case 'K': this->castle_rights[0] = true; break;
-        case 'Q': this->castle_rights[1] = true; break;
-        case 'k': this->castle_rights[2] = true; break;
-        case 'q': this->castle_rights[3] = true; break;
-        default: break;
+size_t State::write_fen(char* buffer, size_t size) const noexcept {
+  // Written in full into a local buffer first, the longest string fitting in it
+  char fen[MAX_FEN_LENGTH];
+  char* out = fen;
+
+  for(int rank = 7; rank >= 0; rank--) {
+    int empty = 0;
+    for(int file = 0; file < 8; file++) {
+      const Piece::piece _p = this->board[rank * 8 + file];
+      if(_p == Piece::NIL) {
+        empty++;
+        continue;
       }
+      if(empty != 0) *out++ = static_cast<char>('0' + empty);
+      empty = 0;
+      *out++ = LETTER_OF_PIECE[_p];
     }
+    if(empty != 0) *out++ = static_cast<char>('0' + empty);
+    if(rank != 0) *out++ = '/';
   }
 
-  if(stages.at(3).at(0) != '-') {
-    char col = stages.at(3).at(0);
-    char row = stages.at(3).at(1);
-    vector<char> tmp;
-    tmp.push_back(col);
-    tmp.push_back(row);
-    unsigned char sq = Square::from_vec(tmp);
-    this->en_passant = sq;
-  } else {
-    this->en_passant = Square::from_vec(vector<char>('-'));
-  }
+  *out++ = ' ';
+  *out++ = this->ply_player == Piece::Color::WHITE ? 'w' : 'b';
+  *out++ = ' ';
 
-  auto halfmoves = static_cast<unsigned short>(std::stoul(stages.at(4)));
-  auto fullmoves = static_cast<unsigned int>(std::stoul(stages.at(5)));
-  this->halfmove = halfmoves;
-  this->fullmove = fullmoves;
-};
+  if(this->castle_rights == 0) *out++ = '-';
+  if(this->castle_rights & CastleRight::WHITE_KINGSIDE) *out++ = 'K';
+  if(this->castle_rights & CastleRight::WHITE_QUEENSIDE) *out++ = 'Q';
+  if(this->castle_rights & CastleRight::BLACK_KINGSIDE) *out++ = 'k';
+  if(this->castle_rights & CastleRight::BLACK_QUEENSIDE) *out++ = 'q';
+  *out++ = ' ';
 
-State::State(State* other) noexcept {
-  this->en_passant = *other->get_en_passant();
-  this->fullmove = *other->get_fullmove_clock();
-  this->halfmove = *other->get_halfmove_clock();
-  this->ply_player = *other->get_ply_player();
+  if(this->en_passant == Square::NULL_SQUARE) {
+    *out++ = '-';
+  } else {
+    *out++ = static_cast<char>('a' + (this->en_passant & 0b111));
+    *out++ = static_cast<char>('1' + (this->en_passant >> 3));
+  }
+  *out++ = ' ';
 
-  this->board = std::vector<Piece::piece>(64);
-  this->castle_rights = std::vector<bool>(4);
+  out = write_number(out, this->halfmove);
+  *out++ = ' ';
+  out = write_number(out, this->fullmove);
 
-  std::copy(other->board.begin(), other->board.end(), this->board.begin());
-  std::copy(other->castle_rights.begin(), other->castle_rights.end(), this->castle_rights.begin());
+  const size_t length = static_cast<size_t>(out - fen);
+  if(length + 1 > size) return 0;
+  std::memcpy(buffer, fen, length);
+  buffer[length] = '\0';
+  return length;
 }
 
-State::~State() noexcept {}
-
 string State::to_fen_string() const noexcept {
-  string fen;
-
-  int index = 56;
-  while(true) {
-    Piece::piece piece = this->board[index];
-    unsigned char _ucir = Piece::get_uci_representation(piece);
-    
-    if(_ucir == '-') {
-      int start = index;
-      for(int whitespaces = 1; whitespaces <= 8; whitespaces++) {
-        index++;
-        unsigned char tmp = Piece::get_uci_representation(this->board[index]);
-        if(tmp != '-' || (index % 8 == 0 && start != index)) {
-          fen += static_cast<char>(whitespaces) + '0';
-          index--;
-          break;
-        }
-      }
-    }
-
-    if(_ucir != '-') fen += _ucir;
+  char fen[MAX_FEN_LENGTH];
+  return string(fen, this->write_fen(fen, sizeof(fen)));
+}
 
-    if(index % 8 == 7) {
-      index -= 16;
-      if(index < -1) break;
-      fen += '/';
-    }
+void State::refresh_keys() noexcept {
+  this->key = 0;
+  this->pawn_key = 0;
 
-    index++;
+  Bitboard::bitboard occupied = this->get_occupancy();
+  while(occupied) {
+    const int sq = Bitboard::pop_lsb(occupied);
+    const Piece::piece _p = this->board[sq];
+    this->key ^= Zobrist::PIECES[_p][sq];
+    if(Piece::get_type(_p) == Piece::Type::PAWN) this->pawn_key ^= Zobrist::PIECES[_p][sq];
   }
 
-  if(this->ply_player == Piece::Color::WHITE) fen += " w ";
-  else fen += " b ";
-
-  string tmp_castling;
-  if(this->castle_rights[0] == true) tmp_castling += 'K';
-  if(this->castle_rights[1] == true) tmp_castling += 'Q';
-  if(this->castle_rights[2] == true) tmp_castling += 'k';
-  if(this->castle_rights[3] == true) tmp_castling += 'q';
-  
-  if(tmp_castling.empty()) fen += "- ";
-  else fen += tmp_castling + ' ';
+  this->key ^= Zobrist::CASTLING[this->get_castle_mask()];
+  if(this->en_passant != Square::NULL_SQUARE) this->key ^= Zobrist::EN_PASSANT[this->en_passant & 0b111];
+  if(this->ply_player == Piece::Color::BLACK) this->key ^= Zobrist::SIDE;
+}
 
-  vector<char> vec_c = Square::from_byte(this->en_passant);
-  string s(vec_c.begin(), vec_c.end());
-  fen += s + ' ';
+void State::refresh_evaluation() noexcept {
+  this->midgame = 0;
+  this->endgame = 0;
+  this->phase = 0;
+
+  Bitboard::bitboard occupied = this->get_occupancy();
+  while(occupied) {
+    const int sq = Bitboard::pop_lsb(occupied);
+    const Piece::piece _p = this->board[sq];
+    this->midgame += Evaluation::MIDGAME[_p][sq];
+    this->endgame += Evaluation::ENDGAME[_p][sq];
+    this->phase += Evaluation::PHASE[_p];
+  }
+}
 
-  fen += std::to_string(this->halfmove) + ' ' + std::to_string(this->fullmove);
+void State::put_piece(unsigned char sq, const Piece::piece& _p) noexcept {
+  const Bitboard::bitboard bit = Bitboard::square(sq);
+  this->board[sq] = _p;
+  this->pieces[_p] |= bit;
+  this->occupancy[Piece::get_color(_p) >> 3] |= bit;
+}
 
-  return fen;
+void State::remove_piece(unsigned char sq) noexcept {
+  const Bitboard::bitboard bit = Bitboard::square(sq);
+  const Piece::piece _p = this->board[sq];
+  this->board[sq] = Piece::NIL;
+  this->pieces[_p] &= ~bit;
+  this->occupancy[Piece::get_color(_p) >> 3] &= ~bit;
 }
 
-Piece::piece* State::get_board() const noexcept {
-  return this->board;
+void State::move_piece(unsigned char from, unsigned char to) noexcept {
+  const Bitboard::bitboard bits = Bitboard::square(from) | Bitboard::square(to);
+  const Piece::piece _p = this->board[from];
+  this->board[from] = Piece::NIL;
+  this->board[to] = _p;
+  this->pieces[_p] ^= bits;
+  this->occupancy[Piece::get_color(_p) >> 3] ^= bits;
 }
 
-bool* State::get_castle_rights() const noexcept {
-  return this->castle_rights;
+unsigned char* State::get_castle_rights() noexcept {
+  return &this->castle_rights;
 }
 
 Piece::Color* State::get_ply_player() noexcept {
@@ -203,4 +284,24 @@ unsigned short* State::get_halfmove_clock() noexcept {
 
 unsigned int* State::get_fullmove_clock() noexcept {
   return &this->fullmove;
-}
\ No newline at end of file
+}
+
+const Piece::Color* State::get_ply_player() const noexcept {
+  return &this->ply_player;
+}
+
+const unsigned char* State::get_castle_rights() const noexcept {
+  return &this->castle_rights;
+}
+
+const unsigned char* State::get_en_passant() const noexcept {
+  return &this->en_passant;
+}
+
+const unsigned short* State::get_halfmove_clock() const noexcept {
+  return &this->halfmove;
+}
+
+const unsigned int* State::get_fullmove_clock() const noexcept {
+  return &this->fullmove;
+}
@@ -2,8 +2,13 @@
 #define STATE_HPP
 
 #pragma once
+#include<cstddef>
 #include<string>
+#include<string_view>
+#include<type_traits>
+#include"bitboard.hpp"
 #include"piece.hpp"
+#include"zobrist.hpp"
 
 /**
  * @brief Class used to store data that can be interpreted from and converted to a FEN string
@@ -11,19 +16,59 @@
  * State state();
  * \endcode
  * @see State::State() noexcept
- * @see State::State(const std::string& fen_string) noexcept
+ * @see State::State(std::string_view fen_string) noexcept
+ * @see State::parse_fen
+ * A State is a plain value: it owns no memory, copies with `memcpy` and can be stored flat in arrays.
+ * Everything but the pieces fits in its first cache line, the bitboards and the board following.
  */
-class State {
+class alignas(64) State {
 public:
+  /**
+   * @brief The bits of \ref State::castle_rights "castle_rights", in the `KQkq` order of a FEN string
+   */
+  enum CastleRight : unsigned char {
+    WHITE_KINGSIDE  = 0b0001,
+    WHITE_QUEENSIDE = 0b0010,
+    BLACK_KINGSIDE  = 0b0100,
+    BLACK_QUEENSIDE = 0b1000,
+  };
+
+  /**
+   * @brief What is wrong with a FEN string, as reported by \ref State::parse_fen "State::parse_fen"
+   */
+  enum class FenError : unsigned char {
+    /// @brief The string is a valid FEN
+    NONE,
+    /// @brief The placement is not 8 ranks of 8 squares, holds an unknown letter, or a pawn on the first or last rank
+    PLACEMENT,
+    /// @brief A side does not have exactly one king
+    KINGS,
+    /// @brief The side to move is neither `w` nor `b`
+    SIDE,
+    /// @brief The castling field is not `-` or a subset of `KQkq` in that order, or gives a right whose king and rook are not on their starting squares
+    CASTLING,
+    /// @brief The en passant field is not `-` or a square right behind a pawn that just moved two squares
+    EN_PASSANT,
+    /// @brief The halfmove clock is not a number below 65536
+    HALFMOVE,
+    /// @brief The fullmove number is not a number
+    FULLMOVE,
+    /// @brief Something follows the last field
+    TRAILING,
+  };
+
+  /// @brief The longest FEN string \ref State::write_fen "State::write_fen" can produce, terminating null character included
+  static constexpr size_t MAX_FEN_LENGTH = 128;
+
   /**
    * @brief Creates an object from the specified `fen_string`
    * \code {.cpp}
    * State state(STARTING_POSITION_FEN);
    * \endcode
    * 
-   * @param fen_string A fen string, in accordance with chess notation
+   * @param fen_string A fen string, in accordance with chess notation. An invalid one gives an empty board, use \ref State::parse_fen "State::parse_fen" to know why
    */
-  explicit State(const std::string& fen_string) noexcept;
+  explicit State(std::string_view fen_string) noexcept;
 
   /**
    * @brief Duplicates a State object from a pointer to one
@@ -31,12 +76,13 @@ public:
    * State state1(STARTING_POSITION_FEN);
    * 
    * State state2(&state1);
+   * State state3 = state1; // the same
    * \endcode 
    * 
    * @param other Other state to copy data from
    * @note Does not create a reference to the other state, only copies its values!
    */
-  explicit State(State* other) noexcept;
+  explicit State(const State* other) noexcept : State(*other) {}
 
   /**
    * @brief Creates an object using \ref STARTING_POSITION_FEN "STARTING_POSITION_FEN"
@@ -47,11 +93,6 @@ public:
    */
   inline State() noexcept : State(STARTING_POSITION_FEN) {};
 
-  /**
-   * @brief Destroys the State object and deallocates the heap memory used by \ref State::board "State::board" and \ref State::castle_rights "State::castle_rights"
-   */
-  ~State() noexcept;
-
   /**
    * @brief Converts the data stored in this object to a FEN string
    * \code {.cpp}
@@ -62,23 +103,137 @@ public:
    */
   [[nodiscard]] std::string to_fen_string() const noexcept;
 
+  /**
+   * @brief Parses and validates a FEN string without allocating memory nor throwing
+   * \code {.cpp}
+   * State state;
+   * if(State::parse_fen(line, &state) != State::FenError::NONE) {} // state left untouched
+   * \endcode
+   * Fields are separated by any number of spaces. The halfmove clock and fullmove number can be left out together, as in EPD files, and default to `0` and `1`.
+   *
+   * @param fen The string to parse
+   * @param state Set to the parsed position on success, untouched otherwise
+   * @return \ref State::FenError::NONE "FenError::NONE" on success, what is wrong with the string otherwise
+   */
+  static FenError parse_fen(std::string_view fen, State* state) noexcept;
+
+  /**
+   * @brief Gets a readable description of a parse error
+   * @param error Any value returned by \ref State::parse_fen "State::parse_fen"
+   * @return A static string, such as `"invalid castling rights"`
+   */
+  static const char* describe(FenError error) noexcept;
+
+  /**
+   * @brief Writes the FEN string of this state into a caller-supplied buffer, without allocating memory
+   * \code {.cpp}
+   * char fen[State::MAX_FEN_LENGTH];
+   * size_t length = state.write_fen(fen, sizeof(fen));
+   * \endcode
+   *
+   * @param buffer Where the string is written, followed by a null character
+   * @param size The size of the buffer, \ref State::MAX_FEN_LENGTH "MAX_FEN_LENGTH" always being enough
+   * @return The length of the string, null character excluded, or `0` if the buffer was too small and nothing was written
+   */
+  size_t write_fen(char* buffer, size_t size) const noexcept;
+
   /**
    * @brief Getter for this object's \ref State::board "board" attribute. \n
    * \n
    * The index of any square can be calculated using \ref Square::from_vec(const std::vector<char>& vec) "Square::from(const std::vector<char>& vec) noexcept"
    * \code {.cpp}
-   * std::vector<Piece::piece>* board = state.get_board();
+   * const Piece::piece* board = state.get_board();
    * std::vector<char> vec();
    * vec.push_back('a');
    * vec.push_back('1');
    * unsigned char index = Square::from_vec(vec); // Get the numerical notation of the A1 square
-   * board->at(index); // Gets the piece on the A1 square
+   * board[index]; // Gets the piece on the A1 square
    * \endcode
    * All items are set to whichever piece was found at that position in the FEN string given upon creation of this State object.
-   * 
-   * @return A pointer to the board vector
+   * The board is a read-only view kept in sync with the bitboards, use \ref State::put_piece "State::put_piece" and \ref State::remove_piece "State::remove_piece" to modify it.
+   *
+   * @return A pointer to the first of the 64 squares
    */
-  std::vector<Piece::piece>* get_board() const noexcept;
+  [[nodiscard]] const Piece::piece* get_board() const noexcept { return this->board; }
+
+  /**
+   * @brief Getter for the set of squares holding a given piece
+   * \code {.cpp}
+   * Bitboard::bitboard white_pawns = state.get_pieces(Piece::make(Piece::Type::PAWN, Piece::Color::WHITE));
+   * \endcode
+   *
+   * @param _p A \ref Piece::piece "piece" (type and color only)
+   * @return A bitboard with one bit set per square holding `_p`
+   */
+  [[nodiscard]] Bitboard::bitboard get_pieces(const Piece::piece& _p) const noexcept { return this->pieces[_p]; }
+
+  /**
+   * @brief Getter for the set of squares holding a given piece
+   * @param type A piece \ref Piece::Type "Type"
+   * @param color A piece \ref Piece::Color "Color"
+   * @return A bitboard with one bit set per square holding such a piece
+   * @overload
+   */
+  [[nodiscard]] Bitboard::bitboard get_pieces(Piece::Type type, Piece::Color color) const noexcept { return this->pieces[static_cast<int>(type) | static_cast<int>(color)]; }
+
+  /**
+   * @brief Getter for the set of squares occupied by one player
+   * @param color A piece \ref Piece::Color "Color"
+   * @return A bitboard with one bit set per square holding a piece of that color
+   */
+  [[nodiscard]] Bitboard::bitboard get_occupancy(Piece::Color color) const noexcept { return this->occupancy[color >> 3]; }
+
+  /**
+   * @brief Getter for the set of occupied squares
+   * @return A bitboard with one bit set per non-empty square
+   * @overload
+   */
+  [[nodiscard]] Bitboard::bitboard get_occupancy() const noexcept { return this->occupancy[0] | this->occupancy[1]; }
+
+  /**
+   * @brief Gets every piece, of both colors, attacking a square
+   * \code {.cpp}
+   * Bitboard::bitboard checkers = state.attackers_to(king_square, state.get_occupancy()) & state.get_occupancy(Piece::Color::BLACK);
+   * \endcode
+   *
+   * @param sq The index of the attacked square
+   * @param occupied The occupancy used to stop sliding pieces, usually \ref State::get_occupancy() "State::get_occupancy()"
+   * @return A bitboard of the attacking pieces' squares
+   */
+  [[nodiscard]] Bitboard::bitboard attackers_to(int sq, Bitboard::bitboard occupied) const noexcept {
+    using Piece::Type, Piece::Color;
+    const Bitboard::bitboard rooks = get_pieces(Type::ROOK, Color::WHITE) | get_pieces(Type::QUEEN, Color::WHITE) |
+      get_pieces(Type::ROOK, Color::BLACK) | get_pieces(Type::QUEEN, Color::BLACK);
+    const Bitboard::bitboard bishops = get_pieces(Type::BISHOP, Color::WHITE) | get_pieces(Type::QUEEN, Color::WHITE) |
+      get_pieces(Type::BISHOP, Color::BLACK) | get_pieces(Type::QUEEN, Color::BLACK);
+
+    return (Bitboard::PAWN_ATTACKS[1][sq] & get_pieces(Type::PAWN, Color::WHITE)) |
+      (Bitboard::PAWN_ATTACKS[0][sq] & get_pieces(Type::PAWN, Color::BLACK)) |
+      (Bitboard::KNIGHT_ATTACKS[sq] & (get_pieces(Type::KNIGHT, Color::WHITE) | get_pieces(Type::KNIGHT, Color::BLACK))) |
+      (Bitboard::KING_ATTACKS[sq] & (get_pieces(Type::KING, Color::WHITE) | get_pieces(Type::KING, Color::BLACK))) |
+      (Bitboard::rook_attacks(sq, occupied) & rooks) |
+      (Bitboard::bishop_attacks(sq, occupied) & bishops);
+  }
+
+  /**
+   * @brief Places a piece on an empty square, updating both the bitboards and the board
+   * @param sq The index of the square
+   * @param _p A \ref Piece::piece "piece", cannot be \ref Piece::NIL "Piece::NIL"
+   */
+  void put_piece(unsigned char sq, const Piece::piece& _p) noexcept;
+
+  /**
+   * @brief Removes the piece standing on a square, updating both the bitboards and the board
+   * @param sq The index of a non-empty square
+   */
+  void remove_piece(unsigned char sq) noexcept;
+
+  /**
+   * @brief Moves the piece standing on `from` to the empty square `to`
+   * @param from The index of a non-empty square
+   * @param to The index of an empty square
+   */
+  void move_piece(unsigned char from, unsigned char to) noexcept;
 
   /**
    * @brief Getter for this object's \ref State::ply_player "ply_player" attribute
@@ -90,21 +245,23 @@ public:
    * @return A pointer to the color of the player (not an array)
    */
   Piece::Color* get_ply_player() noexcept;
+  /// @overload
+  const Piece::Color* get_ply_player() const noexcept;
 
   /**
    * @brief Getter for this object's \ref State::castle_rights "castle_rights" attribute.
    * \code {.cpp}
-   * std::vector<bool>* castle_rights = state.get_castle_rights();
-   * castle_rights->at(0) = true; // Sets castling rights for the white kingside to true
-   * castle_rights->at(1) = true; // Sets castling rights for the white queenside to true
-   * castle_rights->at(2) = true; // Sets castling rights for the black kingside to true
-   * castle_rights->at(3) = true; // Sets castling rights for the black queenside to true
+   * unsigned char* castle_rights = state.get_castle_rights();
+   * *castle_rights |= State::CastleRight::WHITE_KINGSIDE; // Gives white the right to castle kingside
+   * *castle_rights &= ~State::CastleRight::BLACK_QUEENSIDE; // Takes black's right to castle queenside
    * \endcode
-   * By default, all items in `castle_rights` are set to true unless specified otherwise in the FEN string used to generate this State object.
+   * The rights are the ones given by the FEN string used to generate this State object.
    * 
-   * @return A pointer to the castling rights vector
+   * @return A pointer to the rights, one \ref State::CastleRight "CastleRight" bit each
    */
-  std::vector<bool>* get_castle_rights() const noexcept;
+  unsigned char* get_castle_rights() noexcept;
+  /// @overload
+  const unsigned char* get_castle_rights() const noexcept;
 
   /**
    * @brief Getter for this object's \ref State::en_passant "en_passant" attribute
@@ -119,6 +276,8 @@ public:
    * @return An 8-bit unsigned integer which can be parsed by \ref Square::from_byte(const unsigned char& byte) "Square::from_byte(const unsigned char& byte) noexcept"
    */
   unsigned char* get_en_passant() noexcept;
+  /// @overload
+  const unsigned char* get_en_passant() const noexcept;
 
   /**
    * @brief Getter for this object's \ref State::halfmove "halfmove" attribute
@@ -129,6 +288,8 @@ public:
    * @return A 16-bit unsigned integer.
    */
   unsigned short* get_halfmove_clock() noexcept;
+  /// @overload
+  const unsigned short* get_halfmove_clock() const noexcept;
 
   /**
    * @brief Getter for this object's \ref State::fullmove "fullmove" attribute
@@ -139,6 +300,64 @@ public:
    * @return A 32-bit unsigned integer
    */
   unsigned int* get_fullmove_clock() noexcept;
+  /// @overload
+  const unsigned int* get_fullmove_clock() const noexcept;
+
+  /**
+   * @brief Getter for this object's \ref State::key "key" attribute
+   * \code {.cpp}
+   * Zobrist::key key = state.get_key();
+   * \endcode
+   *
+   * @return The Zobrist key of the position, equal for two states holding the same position
+   */
+  [[nodiscard]] Zobrist::key get_key() const noexcept { return this->key; }
+
+  /**
+   * @brief Getter for this object's \ref State::pawn_key "pawn_key" attribute
+   * @return The Zobrist key of the pawns alone
+   */
+  [[nodiscard]] Zobrist::key get_pawn_key() const noexcept { return this->pawn_key; }
+
+  /**
+   * @brief Gets the castling rights packed as bits, see \ref State::CastleRight "CastleRight"
+   * @return A number from `0` to `15`, used to index \ref Zobrist::CASTLING "Zobrist::CASTLING"
+   */
+  [[nodiscard]] unsigned char get_castle_mask() const noexcept { return this->castle_rights; }
+
+  /**
+   * @brief Computes the Zobrist keys from scratch and stores them into \ref State::key "key" and \ref State::pawn_key "pawn_key"
+   * \code {.cpp}
+   * state.refresh_keys(); // after editing the position by hand
+   * \endcode
+   */
+  void refresh_keys() noexcept;
+
+  /**
+   * @brief Getter for this object's \ref State::midgame "midgame" attribute
+   * @return White's middlegame material and placement minus black's, see \ref Evaluation::MIDGAME "Evaluation::MIDGAME"
+   */
+  [[nodiscard]] int get_midgame() const noexcept { return this->midgame; }
+
+  /**
+   * @brief Getter for this object's \ref State::endgame "endgame" attribute
+   * @return White's endgame material and placement minus black's, see \ref Evaluation::ENDGAME "Evaluation::ENDGAME"
+   */
+  [[nodiscard]] int get_endgame() const noexcept { return this->endgame; }
+
+  /**
+   * @brief Getter for this object's \ref State::phase "phase" attribute
+   * @return The game phase from the pieces left, see \ref Evaluation::PHASE "Evaluation::PHASE"
+   */
+  [[nodiscard]] int get_phase() const noexcept { return this->phase; }
+
+  /**
+   * @brief Computes the evaluation sums from scratch and stores them into \ref State::midgame "midgame", \ref State::endgame "endgame" and \ref State::phase "phase"
+   * \code {.cpp}
+   * state.refresh_evaluation(); // after editing the position by hand
+   * \endcode
+   */
+  void refresh_evaluation() noexcept;
 
  /**
   * @brief The FEN string for a starting position.
@@ -148,32 +367,75 @@ public:
   // ----------------------------------
 
   protected:
+  /// @brief The board reads the bitboards directly when generating moves
+  friend class Board;
+
+  /// @brief Selects the constructor of an empty board
+  struct Empty {};
+
+  /**
+   * @brief Creates a board without any piece, white to move, that \ref State::parse_fen "State::parse_fen" fills in
+   */
+  explicit State(Empty) noexcept {}
+
+
+  // Scalars first, so that they share the first cache line
+
+  /**
+   * @brief The Zobrist key of the position. Computed upon construction, then updated by \ref Board::make_move "Board::make_move". Stack-allocated.
+   */
+  Zobrist::key key = 0;
+  /**
+   * @brief The Zobrist key of the pawns only, maintained the same way as \ref State::key "key". Stack-allocated.
+   */
+  Zobrist::key pawn_key = 0;
+  /**
+   * @brief The sum of \ref Evaluation::MIDGAME "Evaluation::MIDGAME" over every piece. Computed upon construction, then updated by \ref Board::make_move "Board::make_move". Stack-allocated.
+   */
+  int midgame = 0;
+  /**
+   * @brief The sum of \ref Evaluation::ENDGAME "Evaluation::ENDGAME" over every piece, maintained the same way as \ref State::midgame "midgame". Stack-allocated.
+   */
+  int endgame = 0;
   /**
-   * @brief The board object. An array of pieces of length 64. Heap-allocated upon construction. Deallocated upon destruction.
+   * @brief The sum of \ref Evaluation::PHASE "Evaluation::PHASE" over every piece, maintained the same way as \ref State::midgame "midgame". Stack-allocated.
    */
-  std::vector<Piece::piece> board;
+  int phase = 0;
+  /**
+   * @brief The current number of moves. Stack-allocated.
+   */
+  unsigned int fullmove = 1;
   /**
    * @brief The player whose turn it is to play. A single number. Stack-allocated.
    */
   Piece::Color ply_player = Piece::Color::WHITE;
   /**
-   * @brief The current rights to castle for each player. Heap-allocated upon construction. Deallocated upon destruction.
-   * Each item is in order of how they would appear in a FEN string. castle_rights[0] is white kingside castle, ...
-   * A FEN string specifies castle rights in the `KQkq` order.
+   * @brief The current number of halfmoves since the last pawn advance or piece capture. Used to enforce the 50-move-rule. Stack-allocated.
    */
-  std::vector<bool> castle_rights;
+  unsigned short halfmove = 0;
   /**
    * @brief The current possible en_passant square. By default, unless specified, is \ref Square::NULL_SQUARE "Square::NULL_SQUARE". Stack-allocated.
    */
   unsigned char en_passant = Square::NULL_SQUARE;
   /**
-   * @brief The current number of halfmoves since the last pawn advance or piece capture. Used to enforce the 50-move-rule. Stack-allocated.
+   * @brief The current rights to castle for each player, one \ref State::CastleRight "CastleRight" bit each. Stack-allocated.
    */
-  unsigned short halfmove = 0;
+  unsigned char castle_rights = 0;
   /**
-   * @brief The current number of moves. Stack-allocated.
+   * @brief One bitboard per color holding all of its pieces, `occupancy[0]` being white and `occupancy[1]` black. Stack-allocated.
    */
-  unsigned int fullmove = 1;
+  Bitboard::bitboard occupancy[2] = {};
+  /**
+   * @brief One bitboard per piece, indexed by its \ref Piece::piece "piece" value (type and color). Stack-allocated.
+   */
+  Bitboard::bitboard pieces[16] = {};
+  /**
+   * @brief The board object. An array of pieces of length 64. Stack-allocated. Secondary view of \ref State::pieces "State::pieces", used to look up the piece on a given square.
+   */
+  Piece::piece board[64] = {};
 };
 
+static_assert(std::is_trivially_copyable_v<State>, "A State must stay copyable with memcpy");
+static_assert(sizeof(State) <= 256, "A State must stay within 4 cache lines");
+
 #endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include"threadpool.hpp"
+
+namespace {
+  // Set for worker threads only, so that tasks can find which pool and worker they run on
+  thread_local const ThreadPool* current_pool = nullptr;
+  thread_local size_t current_index = 0;
+}
+
+ThreadPool::ThreadPool(size_t threads) noexcept {
+  if(threads == 0) threads = std::thread::hardware_concurrency();
+  if(threads == 0) threads = 1;
+
+  for(size_t i = 0; i < threads; i++) this->queues.push_back(std::make_unique<Queue>());
+  for(size_t i = 0; i < threads; i++) this->workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() noexcept {
+  this->wait();
+  {
+    std::lock_guard lock(this->sleep_mutex);
+    this->stopping = true;
+  }
+  this->wake.notify_all();
+  for(std::thread& worker : this->workers) worker.join();
+}
+
+size_t ThreadPool::current_worker() const noexcept {
+  return current_pool == this ? current_index : this->workers.size();
+}
+
+void ThreadPool::submit(std::function<void()> task) noexcept {
+  size_t index = this->current_worker();
+  if(index == this->workers.size()) index = this->next_queue.fetch_add(1, std::memory_order_relaxed) % this->queues.size();
+
+  this->pending.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard lock(this->queues[index]->mutex);
+    this->queues[index]->tasks.push_back(std::move(task));
+    this->queued.fetch_add(1);
+  }
+  {
+    // Taking the lock orders this notification after a worker's emptiness check, so that it cannot be missed
+    std::lock_guard lock(this->sleep_mutex);
+  }
+  this->wake.notify_one();
+}
+
+void ThreadPool::wait() noexcept {
+  std::unique_lock lock(this->sleep_mutex);
+  this->done.wait(lock, [this] { return this->pending.load() == 0; });
+}
+
+bool ThreadPool::pop(size_t index, std::function<void()>* task) noexcept {
+  {
+    Queue& own = *this->queues[index];
+    std::lock_guard lock(own.mutex);
+    if(!own.tasks.empty()) {
+      *task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      this->queued.fetch_sub(1);
+      return true;
+    }
+  }
+
+  for(size_t i = 1; i < this->queues.size(); i++) {
+    Queue& other = *this->queues[(index + i) % this->queues.size()];
+    std::lock_guard lock(other.mutex);
+    if(!other.tasks.empty()) {
+      *task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      this->queued.fetch_sub(1);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::work(size_t index) noexcept {
+  current_pool = this;
+  current_index = index;
+
+  std::function<void()> task;
+  while(true) {
+    if(this->pop(index, &task)) {
+      task();
+      task = nullptr;
+      if(this->pending.fetch_sub(1) == 1) {
+        std::lock_guard lock(this->sleep_mutex);
+        this->done.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock lock(this->sleep_mutex);
+    if(this->stopping) return;
+    // Tasks may have been queued since the failed pop, the count tells without locking every queue
+    if(this->queued.load() > 0) continue;
+    this->wake.wait(lock);
+  }
+}
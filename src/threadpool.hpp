@@ -0,0 +1,91 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#pragma once
+#include<atomic>
+#include<condition_variable>
+#include<cstddef>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+/**
+ * @brief A fixed set of worker threads running submitted tasks, each worker owning a queue and stealing from the others once its own is empty
+ * \code {.cpp}
+ * ThreadPool pool(8);
+ * for(int i = 0; i < 100; i++) pool.submit([i] { work(i); });
+ * pool.wait(); // returns once all 100 tasks are done
+ * \endcode
+ * Tasks submitted from inside a task go to the submitting worker's queue, so that a worker splitting its own work keeps it local unless someone else is idle.
+ */
+class ThreadPool {
+  public:
+  /**
+   * @brief Starts the workers
+   * @param threads The number of workers, `0` meaning one per hardware thread
+   */
+  explicit ThreadPool(size_t threads) noexcept;
+
+  /**
+   * @brief Waits for the queued tasks to finish, then stops the workers
+   */
+  ~ThreadPool() noexcept;
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief Queues a task
+   * @param task Any callable, run exactly once by one of the workers
+   */
+  void submit(std::function<void()> task) noexcept;
+
+  /**
+   * @brief Blocks until every submitted task has finished
+   */
+  void wait() noexcept;
+
+  /**
+   * @brief Getter for the number of workers
+   * @return The number of worker threads
+   */
+  [[nodiscard]] size_t size() const noexcept { return this->workers.size(); }
+
+  /**
+   * @brief Gets the index of the worker running the calling thread, to look up per-worker data
+   * @return A number lower than \ref ThreadPool::size "ThreadPool::size", or `size()` when called from outside the pool
+   */
+  [[nodiscard]] size_t current_worker() const noexcept;
+
+  private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  /**
+   * @brief Takes a task from the worker's own queue (newest first), or steals one from another queue (oldest first)
+   */
+  bool pop(size_t index, std::function<void()>* task) noexcept;
+
+  void work(size_t index) noexcept;
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+
+  std::mutex sleep_mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  /// @brief Number of tasks submitted but not finished yet
+  std::atomic<size_t> pending = 0;
+  /// @brief Number of tasks sitting in a queue, idle workers only sleep when it is zero
+  std::atomic<size_t> queued = 0;
+  /// @brief Used to spread tasks submitted from outside the pool
+  std::atomic<size_t> next_queue = 0;
+  bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include<algorithm>
+
+#include"timeman.hpp"
+
+void TimeManager::start(const Clock& clock, size_t movetime, unsigned int fullmove) noexcept {
+  this->start_time = std::chrono::steady_clock::now();
+  this->previous_best = 0;
+  this->previous_score = 0;
+  this->stability = 0;
+  this->iterations = 0;
+
+  if(movetime != 0) {
+    this->limited = true;
+    this->fixed = true;
+    this->optimum = this->soft = this->hard = movetime;
+    return;
+  }
+
+  this->fixed = false;
+  this->limited = clock.time != 0;
+  if(!this->limited) return;
+
+  const size_t available = clock.time > 2 * MOVE_OVERHEAD ? clock.time - MOVE_OVERHEAD : clock.time / 2;
+
+  // Without a time control ahead, the game is expected to last about 50 moves in the opening and at least 20 more later on
+  const size_t moves_left = clock.moves_to_go != 0 ? std::min<size_t>(clock.moves_to_go, 50) : std::max<size_t>(20, 50 - std::min<size_t>(fullmove, 60) / 2);
+  const size_t share = available / moves_left + clock.increment * 3 / 4;
+
+  // The last move before a time control may use most of the clock, any other move keeps enough for the ones after it
+  const size_t ceiling = moves_left == 1 ? available * 9 / 10 : available * 3 / 5;
+  this->hard = std::max<size_t>(1, std::min(share * 5, ceiling));
+  this->optimum = std::max<size_t>(1, std::min(share, this->hard));
+  this->soft = this->optimum;
+}
+
+void TimeManager::update(Movement::move best_move, int score) noexcept {
+  const bool first = this->iterations++ == 0;
+  const int swing = first ? 0 : this->previous_score - score;
+  this->stability = !first && best_move == this->previous_best ? this->stability + 1 : 0;
+  this->previous_best = best_move;
+  this->previous_score = score;
+  if(this->fixed || !this->limited) return;
+
+  // A best move that keeps changing needs more time to settle, one that survived several iterations is unlikely to change anymore
+  const double stability_scale = std::max(0.5, 1.5 - 0.2 * this->stability);
+  // A falling score means a problem was just found, worth more time to find an answer
+  const double swing_scale = 1.0 + std::clamp(swing, 0, 100) / 100.0;
+
+  const auto adjusted = static_cast<size_t>(static_cast<double>(this->optimum) * stability_scale * swing_scale);
+  this->soft = std::clamp<size_t>(adjusted, 1, this->hard);
+}
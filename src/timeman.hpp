@@ -0,0 +1,102 @@
+#ifndef TIMEMAN_HPP
+#define TIMEMAN_HPP
+
+#pragma once
+#include<chrono>
+#include<cstddef>
+#include"movement.hpp"
+
+/**
+ * @brief Decides how long a search may run from the clock of the player to move
+ * \code {.cpp}
+ * TimeManager tm;
+ * tm.start({ 60000, 1000, 0 }, 0, fullmove); // 60s + 1s per move
+ * while(!tm.soft_limit_reached()) {
+ *   search_iteration(); // checking tm.hard_limit_reached() every few thousand nodes
+ *   tm.update(best_move, score);
+ * }
+ * \endcode
+ * Two limits are kept: no new iteration is started past the soft limit, which grows while the best move keeps changing or the score drops and shrinks once the best move is stable, and the search is interrupted at the hard limit whatever happens.
+ */
+class TimeManager {
+  public:
+  /**
+   * @brief The clock of the player to move, as sent by `go wtime/btime/winc/binc/movestogo`
+   */
+  struct Clock {
+    /// @brief Remaining time, in milliseconds. `0` if the game is not timed
+    size_t time = 0;
+    /// @brief Time added after every move, in milliseconds
+    size_t increment = 0;
+    /// @brief Moves to play before the next time control, `0` if the rest of the game must be played with the remaining time
+    size_t moves_to_go = 0;
+  };
+
+  /// @brief Time kept aside for the communication with the GUI, in milliseconds
+  static constexpr size_t MOVE_OVERHEAD = 30;
+
+  /**
+   * @brief Starts the clock and computes the limits of a new search
+   * @param clock The clock of the player to move
+   * @param movetime A fixed time to spend in milliseconds, used instead of the clock if not `0`
+   * @param fullmove The fullmove counter of the position, earlier moves getting less time as more of them remain to be played
+   */
+  void start(const Clock& clock, size_t movetime, unsigned int fullmove) noexcept;
+
+  /**
+   * @brief Starts the clock over, keeping the limits. Used once a ponder search's expected move is played, the time spent pondering being the opponent's
+   */
+  void restart() noexcept { this->start_time = std::chrono::steady_clock::now(); }
+
+  /**
+   * @brief Adjusts the soft limit after a finished iteration
+   * @param best_move The best move of the iteration
+   * @param score The score of the iteration
+   */
+  void update(Movement::move best_move, int score) noexcept;
+
+  /**
+   * @brief Gets the time spent since \ref TimeManager::start "TimeManager::start"
+   * @return A duration in milliseconds
+   */
+  [[nodiscard]] size_t elapsed() const noexcept {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->start_time).count();
+  }
+
+  /**
+   * @brief Checks whether starting a new iteration would waste time
+   * @return `true` if the search should not start another iteration
+   */
+  [[nodiscard]] bool soft_limit_reached() const noexcept { return this->limited && this->elapsed() >= this->soft; }
+
+  /**
+   * @brief Checks whether the search must stop right now. Reads the clock, so callers only do it every few thousand nodes
+   * @return `true` if the search must be interrupted
+   */
+  [[nodiscard]] bool hard_limit_reached() const noexcept { return this->limited && this->elapsed() >= this->hard; }
+
+  /**
+   * @brief Getter for whether the search is limited by time at all
+   * @return `false` if neither a clock nor a fixed time was given
+   */
+  [[nodiscard]] bool is_limited() const noexcept { return this->limited; }
+
+  private:
+  std::chrono::steady_clock::time_point start_time;
+  bool limited = false;
+  /// @brief Whether the limits come from a fixed move time, which is never adjusted
+  bool fixed = false;
+  /// @brief The soft limit before any adjustment, in milliseconds
+  size_t optimum = 0;
+  size_t soft = 0;
+  size_t hard = 0;
+
+  Movement::move previous_best = 0;
+  int previous_score = 0;
+  /// @brief Number of iterations in a row that kept the same best move
+  int stability = 0;
+  /// @brief Number of iterations finished so far
+  int iterations = 0;
+};
+
+#endif
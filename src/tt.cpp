@@ -0,0 +1,142 @@
+#include<algorithm>
+#include<atomic>
+#include<cstdlib>
+#include<cstring>
+
+#include"tt.hpp"
+
+#if defined(__linux__)
+#include<sys/mman.h>
+#endif
+
+namespace {
+  // Data layout: MMMMMMMMMMMMMMMM SSSSSSSSSSSSSSSS DDDDDDDD BB AAAAAA, M=move ; S=score ; D=depth ; B=bound ; A=age
+  // The depth saturates rather than wrapping, so that the deepest results never look like the shallowest
+  constexpr std::uint64_t pack(Movement::move move, int score, int depth, TranspositionTable::Bound bound, unsigned char age) noexcept {
+    return static_cast<std::uint64_t>(move) << 32 |
+      static_cast<std::uint64_t>(static_cast<std::uint16_t>(score)) << 16 |
+      static_cast<std::uint64_t>(static_cast<std::uint8_t>(std::clamp(depth, -128, 127))) << 8 |
+      static_cast<std::uint64_t>(bound) << 6 |
+      age;
+  }
+
+  constexpr Movement::move move_of(std::uint64_t data) noexcept { return static_cast<Movement::move>(data >> 32); }
+  constexpr int score_of(std::uint64_t data) noexcept { return static_cast<std::int16_t>(data >> 16); }
+  constexpr int depth_of(std::uint64_t data) noexcept { return static_cast<std::int8_t>(data >> 8); }
+  constexpr TranspositionTable::Bound bound_of(std::uint64_t data) noexcept { return static_cast<TranspositionTable::Bound>((data >> 6) & 0b11); }
+  constexpr unsigned char age_of(std::uint64_t data) noexcept { return data & 0b111111; }
+
+  std::uint64_t load(const std::uint64_t& word) noexcept {
+    return std::atomic_ref<const std::uint64_t>(word).load(std::memory_order_relaxed);
+  }
+
+  void save(std::uint64_t& word, std::uint64_t value) noexcept {
+    std::atomic_ref<std::uint64_t>(word).store(value, std::memory_order_relaxed);
+  }
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes) noexcept {
+  this->resize(megabytes);
+}
+
+TranspositionTable::~TranspositionTable() noexcept {
+  this->release();
+}
+
+void TranspositionTable::release() noexcept {
+  std::free(this->clusters);
+  this->clusters = nullptr;
+  this->cluster_count = 0;
+}
+
+void TranspositionTable::resize(size_t megabytes) noexcept {
+  this->release();
+
+  size_t bytes = megabytes * 1024 * 1024;
+  if(bytes < sizeof(Cluster)) bytes = sizeof(Cluster);
+
+#if defined(__linux__)
+  // Transparent huge pages need 2 MB aligned memory, and save most TLB misses on large tables
+  constexpr size_t alignment = 2 * 1024 * 1024;
+#else
+  constexpr size_t alignment = alignof(Cluster);
+#endif
+  const size_t rounded = (bytes + alignment - 1) / alignment * alignment;
+
+  this->clusters = static_cast<Cluster*>(std::aligned_alloc(alignment, rounded));
+  if(this->clusters == nullptr) {
+    this->clusters = static_cast<Cluster*>(std::aligned_alloc(alignof(Cluster), sizeof(Cluster)));
+    bytes = sizeof(Cluster);
+  }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  else madvise(this->clusters, rounded, MADV_HUGEPAGE);
+#endif
+
+  this->cluster_count = bytes / sizeof(Cluster);
+  this->clear();
+}
+
+void TranspositionTable::clear() noexcept {
+  std::memset(static_cast<void*>(this->clusters), 0, this->cluster_count * sizeof(Cluster));
+  this->generation = 0;
+}
+
+bool TranspositionTable::probe(Zobrist::key key, Data* data) const noexcept {
+  const Cluster& cluster = this->clusters[this->index(key)];
+
+  for(const Entry& entry : cluster.entries) {
+    const std::uint64_t word = load(entry.data);
+    if((load(entry.check) ^ word) != key || bound_of(word) == Bound::NONE) continue;
+
+    data->move = move_of(word);
+    data->score = score_of(word);
+    data->depth = depth_of(word);
+    data->bound = bound_of(word);
+    return true;
+  }
+
+  return false;
+}
+
+void TranspositionTable::store(Zobrist::key key, Movement::move move, int score, int depth, Bound bound) noexcept {
+  Cluster& cluster = this->clusters[this->index(key)];
+
+  // Same position first, otherwise the shallowest entry, entries of older searches counting as much shallower
+  Entry* replaced = &cluster.entries[0];
+  int lowest = 1 << 30;
+  for(Entry& entry : cluster.entries) {
+    const std::uint64_t word = load(entry.data);
+    if((load(entry.check) ^ word) == key) {
+      replaced = &entry;
+      if(move == 0) move = move_of(word);
+      // A bound does not overwrite an entry of this search more than two plies deeper, whatever that entry's bound
+      if(bound != Bound::EXACT && depth + 2 < depth_of(word) && age_of(word) == this->generation) return;
+      break;
+    }
+
+    const int age_difference = (this->generation - age_of(word)) & 0b111111;
+    const int value = bound_of(word) == Bound::NONE ? -(1 << 20) : depth_of(word) - 8 * age_difference;
+    if(value < lowest) {
+      lowest = value;
+      replaced = &entry;
+    }
+  }
+
+  const std::uint64_t word = pack(move, score, depth, bound, this->generation);
+  save(replaced->check, key ^ word);
+  save(replaced->data, word);
+}
+
+int TranspositionTable::hashfull() const noexcept {
+  const size_t sampled = this->cluster_count < 250 ? this->cluster_count : 250;
+  if(sampled == 0) return 0;
+
+  int used = 0;
+  for(size_t i = 0; i < sampled; i++) {
+    for(const Entry& entry : this->clusters[i].entries) {
+      const std::uint64_t word = load(entry.data);
+      if(bound_of(word) != Bound::NONE && age_of(word) == this->generation) used++;
+    }
+  }
+  return static_cast<int>(used * 1000 / (sampled * 4));
+}
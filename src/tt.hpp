@@ -0,0 +1,132 @@
+#ifndef TT_HPP
+#define TT_HPP
+
+#pragma once
+#include<cstddef>
+#include<cstdint>
+#include"movement.hpp"
+#include"zobrist.hpp"
+
+/**
+ * @brief A hash table remembering the result of every searched node, shared by every search thread
+ * \code {.cpp}
+ * TranspositionTable tt(256); // 256 MB
+ * tt.store(board.get_key(), best_move, score, depth, TranspositionTable::Bound::EXACT);
+ *
+ * TranspositionTable::Data data;
+ * if(tt.probe(board.get_key(), &data)) {}
+ * \endcode
+ * Entries are 16 bytes and grouped by 4 into 64-byte clusters, so that a probe touches a single cache line.
+ * Threads read and write entries without locking: each entry stores its key XOR-ed with its data, so that an entry torn by two concurrent writes no longer matches any key and is ignored.
+ */
+class TranspositionTable {
+  public:
+  /**
+   * @brief What the stored score tells about the real score of the node
+   */
+  enum Bound : unsigned char {
+    /// @brief Nothing stored
+    NONE  = 0,
+    /// @brief The real score is at most the stored one (no move beat alpha)
+    UPPER = 1,
+    /// @brief The real score is at least the stored one (a move beat beta)
+    LOWER = 2,
+    /// @brief The stored score is the real score
+    EXACT = 3,
+  };
+
+  /**
+   * @brief The content of an entry, once unpacked
+   */
+  struct Data {
+    /// @brief The best move found, `0` if none
+    Movement::move move = 0;
+    int score = 0;
+    int depth = 0;
+    Bound bound = Bound::NONE;
+  };
+
+  /**
+   * @brief Allocates a table, on large pages where the system allows it
+   * @param megabytes The size of the table
+   */
+  explicit TranspositionTable(size_t megabytes) noexcept;
+  ~TranspositionTable() noexcept;
+
+  TranspositionTable(const TranspositionTable&) = delete;
+  TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+  /**
+   * @brief Reallocates the table, losing its content. Must not be called while a search is running
+   * @param megabytes The new size of the table
+   */
+  void resize(size_t megabytes) noexcept;
+
+  /**
+   * @brief Empties the table. Must not be called while a search is running
+   */
+  void clear() noexcept;
+
+  /**
+   * @brief Marks the entries written so far as older than the ones the next search will write, so that they get replaced first
+   */
+  void new_search() noexcept { this->generation = (this->generation + 1) & 0b111111; }
+
+  /**
+   * @brief Looks up a position
+   * @param key The Zobrist key of the position
+   * @param data Set to the entry's content on success
+   * @return `true` if the position was found
+   */
+  bool probe(Zobrist::key key, Data* data) const noexcept;
+
+  /**
+   * @brief Stores the result of a search, replacing the least useful entry of the cluster
+   * @param key The Zobrist key of the position
+   * @param move The best move found, `0` to keep the one already stored for that position
+   * @param score The score, already adjusted so that mate scores are relative to the node
+   * @param depth The remaining depth the score was found with, stored as 127 when it is deeper
+   * @param bound The kind of score
+   */
+  void store(Zobrist::key key, Movement::move move, int score, int depth, Bound bound) noexcept;
+
+  /**
+   * @brief Asks the CPU to start loading the cluster of a position, so that it is cached by the time it is probed
+   * @param key The Zobrist key of the position
+   */
+  void prefetch(Zobrist::key key) const noexcept {
+    __builtin_prefetch(&this->clusters[this->index(key)]);
+  }
+
+  /**
+   * @brief Estimates how full the table is, counting only the entries of the current search
+   * @return A number of entries per thousand
+   */
+  [[nodiscard]] int hashfull() const noexcept;
+
+  private:
+  struct Entry {
+    std::uint64_t check;
+    std::uint64_t data;
+  };
+
+  struct alignas(64) Cluster {
+    Entry entries[4];
+  };
+
+  /**
+   * @brief Maps a key to a cluster, using the high bits of a 128-bit product so that any cluster count works
+   */
+  [[nodiscard]] size_t index(Zobrist::key key) const noexcept {
+    return static_cast<size_t>((static_cast<unsigned __int128>(key) * this->cluster_count) >> 64);
+  }
+
+  void release() noexcept;
+
+  Cluster* clusters = nullptr;
+  size_t cluster_count = 0;
+  /// @brief Age of the current search, 6 bits
+  unsigned char generation = 0;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include<algorithm>
+#include<cctype>
+#include<cstdlib>
+
+#include"uci.hpp"
+
+namespace {
+  std::string lowercase(std::string s) noexcept {
+    for(char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+  }
+
+  std::string format_move(Movement::move mv) noexcept {
+    // The protocol's null move, sent when there is nothing to play
+    return mv == 0 ? "0000" : Movement::from_u16(mv);
+  }
+}
+
+std::string UCI::format_score(int score) noexcept {
+  if(Search::is_mate(score)) return "mate " + std::to_string(Search::mate_in(score));
+  return "cp " + std::to_string(score);
+}
+
+UCI::Engine::Engine(std::ostream& out) noexcept : out(out), table(DEFAULT_HASH), searcher(this->board, this->table) {}
+
+UCI::Engine::~Engine() noexcept {
+  this->stop();
+}
+
+void UCI::Engine::send(const std::string& line) noexcept {
+  std::lock_guard lock(this->out_mutex);
+  this->out << line << std::endl;
+}
+
+void UCI::Engine::loop(std::istream& in) noexcept {
+  std::string line;
+  while(std::getline(in, line)) {
+    if(!this->execute(line)) break;
+  }
+  this->stop();
+}
+
+bool UCI::Engine::execute(const std::string& line) noexcept {
+  std::istringstream command(line);
+  std::string token;
+  command >> token;
+
+  if(token == "uci") {
+    this->send(std::string("id name ") + NAME);
+    this->send(std::string("id author ") + AUTHOR);
+    this->send("option name Hash type spin default " + std::to_string(DEFAULT_HASH) + " min 1 max " + std::to_string(MAX_HASH));
+    this->send("option name Threads type spin default 1 min 1 max " + std::to_string(MAX_THREADS));
+    this->send("option name Clear Hash type button");
+    this->send("option name Ponder type check default false");
+    this->send("option name EvalFile type string default <empty>");
+    this->send("uciok");
+  } else if(token == "isready") {
+    this->send("readyok");
+  } else if(token == "ucinewgame") {
+    this->stop();
+    this->table.clear();
+  } else if(token == "position") {
+    this->stop();
+    this->position(command);
+  } else if(token == "go") {
+    this->stop();
+    this->go(command);
+  } else if(token == "stop") {
+    this->stop();
+  } else if(token == "ponderhit") {
+    this->searcher.ponderhit();
+    {
+      std::lock_guard lock(this->state_mutex);
+      this->waiting = false;
+    }
+    this->state_changed.notify_all();
+  } else if(token == "setoption") {
+    this->stop();
+    this->setoption(command);
+  } else if(token == "d") {
+    // Not part of the protocol, prints the position for debugging
+    this->send(this->board.display());
+    this->send("Fen: " + this->board.get_fen());
+  } else if(token == "quit") {
+    this->stop();
+    return false;
+  }
+
+  return true;
+}
+
+void UCI::Engine::stop() noexcept {
+  this->searcher.stop();
+  {
+    std::lock_guard lock(this->state_mutex);
+    this->waiting = false;
+  }
+  this->state_changed.notify_all();
+  if(this->search_thread.joinable()) this->search_thread.join();
+}
+
+void UCI::Engine::position(std::istringstream& command) noexcept {
+  std::string token;
+  command >> token;
+
+  std::string fen;
+  if(token == "startpos") {
+    fen = State::STARTING_POSITION_FEN;
+    command >> token;
+  } else if(token == "fen") {
+    while(command >> token && token != "moves") fen += (fen.empty() ? "" : " ") + token;
+  } else {
+    return;
+  }
+
+  State parsed;
+  const State::FenError error = State::parse_fen(fen, &parsed);
+  if(error != State::FenError::NONE) {
+    this->send(std::string("info string invalid fen, ") + State::describe(error));
+    return;
+  }
+
+  this->board.set_state(parsed);
+  if(token != "moves") return;
+
+  while(command >> token) {
+    if(!this->board.try_make_move(Movement::from_uci(token))) {
+      this->send("info string illegal move " + token);
+      return;
+    }
+  }
+}
+
+void UCI::Engine::go(std::istringstream& command) noexcept {
+  Search::Limits limits;
+  size_t time[2] = {}, increment[2] = {}, moves_to_go = 0;
+
+  std::string token;
+  while(command >> token) {
+    if(token == "depth") command >> limits.depth;
+    else if(token == "nodes") command >> limits.nodes;
+    else if(token == "movetime") command >> limits.movetime;
+    else if(token == "wtime") command >> time[0];
+    else if(token == "btime") command >> time[1];
+    else if(token == "winc") command >> increment[0];
+    else if(token == "binc") command >> increment[1];
+    else if(token == "movestogo") command >> moves_to_go;
+    else if(token == "infinite") limits.infinite = true;
+    else if(token == "ponder") limits.ponder = true;
+  }
+
+  const size_t us = *this->board.get_state().get_ply_player() == Piece::Color::WHITE ? 0 : 1;
+  limits.clock.time = time[us];
+  limits.clock.increment = increment[us];
+  limits.clock.moves_to_go = moves_to_go;
+
+  this->searcher.clear_stop();
+  this->searcher.set_position(this->board);
+  {
+    std::lock_guard lock(this->state_mutex);
+    this->waiting = limits.infinite || limits.ponder;
+  }
+
+  this->search_thread = std::thread([this, limits] {
+    const Search::Result result = this->searcher.search(limits, [this](const Search::Info& info) {
+      std::string line = "info depth " + std::to_string(info.depth) + " seldepth " + std::to_string(info.seldepth)
+        + " score " + format_score(info.score) + " nodes " + std::to_string(info.nodes)
+        + " nps " + std::to_string(info.nodes * 1000 / std::max<size_t>(info.time, 1))
+        + " hashfull " + std::to_string(this->table.hashfull()) + " time " + std::to_string(info.time) + " pv";
+      for(const Movement::move& mv : info.pv) line += " " + Movement::from_u16(mv);
+      this->send(line);
+    });
+
+    {
+      std::unique_lock lock(this->state_mutex);
+      this->state_changed.wait(lock, [this] { return !this->waiting; });
+    }
+
+    std::string line = "bestmove " + format_move(result.best_move);
+    if(result.ponder_move != 0) line += " ponder " + format_move(result.ponder_move);
+    this->send(line);
+  });
+}
+
+void UCI::Engine::setoption(std::istringstream& command) noexcept {
+  std::string token, name, value;
+  command >> token;
+  if(token != "name") return;
+
+  while(command >> token && token != "value") name += (name.empty() ? "" : " ") + token;
+  while(command >> token) value += (value.empty() ? "" : " ") + token;
+
+  name = lowercase(name);
+  if(name == "hash") {
+    const size_t megabytes = std::strtoull(value.c_str(), nullptr, 10);
+    this->table.resize(std::clamp<size_t>(megabytes, 1, MAX_HASH));
+  } else if(name == "threads") {
+    const size_t threads = std::strtoull(value.c_str(), nullptr, 10);
+    this->searcher.set_threads(std::clamp<size_t>(threads, 1, MAX_THREADS));
+  } else if(name == "clear hash") {
+    this->table.clear();
+  } else if(name == "evalfile") {
+    this->searcher.set_network(nullptr);
+    if(value.empty() || value == "<empty>") return;
+    if(this->network.load(value)) {
+      this->searcher.set_network(&this->network);
+      this->send("info string NNUE evaluation using " + value + " (" + NNUE::simd_name() + ")");
+    } else {
+      this->send("info string could not load " + value + ", using the piece-square tables");
+    }
+  } else if(name != "ponder") {
+    this->send("info string unknown option " + name);
+  }
+}
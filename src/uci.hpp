@@ -0,0 +1,122 @@
+#ifndef UCI_HPP
+#define UCI_HPP
+
+#pragma once
+#include<condition_variable>
+#include<istream>
+#include<memory>
+#include<mutex>
+#include<ostream>
+#include<sstream>
+#include<string>
+#include<thread>
+#include"board.hpp"
+#include"nnue.hpp"
+#include"search.hpp"
+#include"tt.hpp"
+
+/**
+ * @brief Namespace holding the Universal Chess Interface front-end, used by GUIs and match runners to drive the engine
+ * \code {.cpp}
+ * UCI::Engine engine(std::cout);
+ * engine.loop(std::cin);
+ * \endcode
+ */
+namespace UCI {
+  /// @brief The name reported to the GUI
+  constexpr char NAME[] = "SaphirsChess";
+  /// @brief The author reported to the GUI
+  constexpr char AUTHOR[] = "SaphirDeFeu";
+
+  /// @brief Default size of the transposition table, in megabytes
+  constexpr size_t DEFAULT_HASH = 16;
+  /// @brief Largest transposition table the `Hash` option accepts, in megabytes
+  constexpr size_t MAX_HASH = 1 << 20;
+  /// @brief Most threads the `Threads` option accepts
+  constexpr size_t MAX_THREADS = 1024;
+
+  /**
+   * @brief Reads UCI commands and answers them. \n
+   * Searches run on their own thread, so that commands such as `stop`, `ponderhit` or `isready` are answered while searching.
+   */
+  class Engine {
+    public:
+    /**
+     * @brief Creates an engine at the starting position
+     * @param out Where the answers are written
+     */
+    explicit Engine(std::ostream& out) noexcept;
+
+    /**
+     * @brief Stops the running search, if any
+     */
+    ~Engine() noexcept;
+
+    Engine(const Engine&) = delete;
+    Engine& operator=(const Engine&) = delete;
+
+    /**
+     * @brief Runs commands read line by line until `quit` or the end of the input
+     * @param in Where the commands are read from
+     */
+    void loop(std::istream& in) noexcept;
+
+    /**
+     * @brief Runs a single command
+     * @param line The command, unknown ones being ignored as the protocol requires
+     * @return `false` if the command was `quit`
+     */
+    bool execute(const std::string& line) noexcept;
+
+    private:
+    /**
+     * @brief Handles `position [startpos | fen <fen>] [moves <move>...]`
+     */
+    void position(std::istringstream& command) noexcept;
+
+    /**
+     * @brief Handles `go [depth <N>] [nodes <N>] [movetime <ms>] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <N>] [infinite] [ponder]`
+     */
+    void go(std::istringstream& command) noexcept;
+
+    /**
+     * @brief Handles `setoption name <name> [value <value>]`, for the options listed by `uci`
+     */
+    void setoption(std::istringstream& command) noexcept;
+
+    /**
+     * @brief Stops the running search, if any, and waits for its thread to print its best move and finish
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief Writes a whole line to the output, search and input threads taking turns
+     */
+    void send(const std::string& line) noexcept;
+
+    std::ostream& out;
+    std::mutex out_mutex;
+
+    Board board;
+    TranspositionTable table;
+    /// @brief Loaded by the `EvalFile` option, the piece-square tables being used until then
+    NNUE::Network network;
+    Search::Searcher searcher;
+    std::thread search_thread;
+
+    /// @brief Guards \ref UCI::Engine::waiting "waiting"
+    std::mutex state_mutex;
+    std::condition_variable state_changed;
+    /// @brief Set while an infinite or pondering search may not print its best move yet, the protocol requiring a `stop` or `ponderhit` first
+    bool waiting = false;
+  };
+
+  /**
+   * @brief Formats a search score for an `info` line
+   * @param score A score from \ref Search::Result "Search::Result" or \ref Search::Info "Search::Info"
+   * @return `cp <centipawns>`, or `mate <moves>` negative when getting mated
+   */
+  std::string format_score(int score) noexcept;
+}
+
+#endif
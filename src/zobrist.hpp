@@ -0,0 +1,67 @@
+#ifndef ZOBRIST_HPP
+#define ZOBRIST_HPP
+
+#pragma once
+#include<array>
+#include<cstdint>
+
+/**
+ * @brief Namespace holding the random numbers XOR-ed together to build a position's key
+ * \code {.cpp}
+ * Zobrist::key key = 0;
+ * key ^= Zobrist::PIECES[Piece::make('K')][4]; // a white king on e1
+ * key ^= Zobrist::SIDE; // black to play
+ * \endcode
+ * The keys are generated at compile time from a fixed seed, so a position has the same key on every run.
+ */
+namespace Zobrist {
+  using key = std::uint64_t;
+
+  namespace detail {
+    // splitmix64, good enough to spread a counter over 64 bits
+    constexpr key next(key& state) noexcept {
+      key z = (state += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    }
+
+    struct Keys {
+      std::array<std::array<key, 64>, 16> pieces{};
+      std::array<key, 16> castling{};
+      std::array<key, 8> en_passant{};
+      key side = 0;
+    };
+
+    constexpr Keys make_keys() noexcept {
+      Keys keys;
+      key state = 0x5A9B1C3D4E5F6071ULL;
+      for(auto& piece : keys.pieces) {
+        for(key& k : piece) k = next(state);
+      }
+      // Each castling right gets its own key, combinations are XOR-ed from them so that losing one right is a single XOR
+      key rights[4] = { next(state), next(state), next(state), next(state) };
+      for(int mask = 0; mask < 16; mask++) {
+        for(int i = 0; i < 4; i++) {
+          if(mask & (1 << i)) keys.castling[mask] ^= rights[i];
+        }
+      }
+      for(key& k : keys.en_passant) k = next(state);
+      keys.side = next(state);
+      return keys;
+    }
+
+    inline constexpr Keys KEYS = make_keys();
+  }
+
+  /// @brief One key per \ref Piece::piece "piece" value and square (index `0` and the unused piece values are never XOR-ed in)
+  inline constexpr const std::array<std::array<key, 64>, 16>& PIECES = detail::KEYS.pieces;
+  /// @brief One key per set of castling rights, indexed by \ref State::get_castle_mask "State::get_castle_mask"
+  inline constexpr const std::array<key, 16>& CASTLING = detail::KEYS.castling;
+  /// @brief One key per column of the en passant square, only XOR-ed in when there is one
+  inline constexpr const std::array<key, 8>& EN_PASSANT = detail::KEYS.en_passant;
+  /// @brief XOR-ed in when black is to play
+  inline constexpr key SIDE = detail::KEYS.side;
+}
+
+#endif